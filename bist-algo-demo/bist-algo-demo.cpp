@@ -10,202 +10,251 @@
 #include <fstream>
 #include <chrono>
 #include <iomanip>
+#include <algorithm>
+#include <mutex>
+#include <thread>
 
 #include "nasdaq/itch_bist_protocol.hh"
 #include "symbol_tracker_algo.h"
+#include "sweep_recovery_algo.h"
 #include "net.hh"
 
 using namespace helix;
 using clock_type = std::chrono::high_resolution_clock;
 
+// the cpus match Cpus_allowed_list in /proc/self/task/<tid>/status. the memory node is the
+// preferred node read back with get_mempolicy, which /proc does not show per thread; the
+// pages the thread allocates show up under it in /proc/self/numa_maps.
+static void print_thread_placement(const std::string& name)
+{
+	std::cout << name << " thread " << current_thread_id() << ": cpus";
+	for (auto cpu : current_thread_cpus()) {
+		std::cout << " " << cpu;
+	}
+	std::cout << ", numa node " << current_numa_node() << ", memory node " << current_memory_node() << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
 	std::string input = argv[1];
 	std::ifstream input_fd;
 
+	// optional thread topology file, see thread_topology.hh
+	thread_topology topology;
+	if (argc > 2) {
+		std::ifstream topology_fd(argv[2]);
+		topology = thread_topology::parse(topology_fd);
+	}
+	// pin the feed thread before the session allocates its books
+	pin_current_thread(topology.feed);
+
 	helix::nasdaq::itch_bist_protocol protocol{ "nasdaq-binaryfile-itch-bist" };
 	std::shared_ptr<session> session(protocol.new_session(nullptr));
 
+	// the algos share one worker per configured algo cpu, or per core if none is configured
+	size_t workers = !topology.algos.empty() ? topology.algos.size()
+		: std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	algo_scheduler scheduler{ workers, topology.algos };
+	auto create_algo = [&](std::vector<std::string> symbols) {
+		return symbol_tracker_algo::create_new_algo(session, std::move(symbols), scheduler);
+	};
+
 	std::vector<algo_base*> algos
 	{
-		symbol_tracker_algo::create_new_algo(session, {"ACSEL.E ", "AKBNK.E ", "GARAN.E ", "HALKB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ADEL.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"ADESE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AEFES.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AFYON.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AGHOL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AGYO.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKBNK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKCNS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKENR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKFGY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKGRT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKMGY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKSA.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKSEN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKSGY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKSUE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AKYHO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALARK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALBRK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALCAR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALCTL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALKA.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"ALKIM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ANELE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ANHYT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ANSGR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ARCLK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ARDYZ.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ARENA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ARMDA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ARSAN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ASELS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ASUZU.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ATAGY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ATEKS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AVGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AVHOL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AVISA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AVOD.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"AVTUR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AYCES.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"AYEN.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"AYGAZ.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BAGFS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BAKAB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BANVT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BAYRK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BERA.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"BEYAZ.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BFREN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BIMAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BIZIM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BJKAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BLCYT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BNTAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BOSSA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BRISA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BRKSN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BRMEN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BRSAN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BRYAT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BSOKE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BTCIM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BUCIM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BURCE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"BURVA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CCOLA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CELHA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CEMAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CEMTS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CEOEM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CIMSA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CLEBI.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CMBTN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CMENT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CRDFA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CRFSA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"CUSAN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DAGHL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DAGI.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"DERAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DERIM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DESA.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"DESPC.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DEVA.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"DGATE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DGGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DGKLB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DITAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DMSAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DNISI.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOAS.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOBUR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOCO.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOGUB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOHOL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DOKTA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DURDO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DYOBY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"DZGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ECILC.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ECZYT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EDIP.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"EGEEN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EGGUB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EGPRO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EGSER.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EKGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EMKEL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ENJSA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ENKAI.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ERBOS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"EREGL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ERSU.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"ESCOM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ESEN.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"EUHOL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"FADE.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"FENER.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"FLAP.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"FMIZP.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"FONET.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"FORMT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"FROTO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GARAN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GARFA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GEDIK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GEDZA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GENTS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GEREL.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GLBMD.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GLRYH.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GLYHO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GOLTS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GOODY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GOZDE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GSDDE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GSDHO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GSRAY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"GUBRF.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HALKB.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HATEK.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HDFGS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HEKTS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HLGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HUBVC.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"HURGZ.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ICBCT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IDEAS.E "}),
-		//symbol_tracker_algo::create_new_algo(session, {"IDGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IEYHO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IHEVA.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IHGZT.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IHLAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IHLGM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IHYAY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"INDES.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"INFO.E  "}),
-		symbol_tracker_algo::create_new_algo(session, {"INTEM.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"INVEO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IPEKE.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISATR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISBTR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISCTR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISDMR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISFIN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISGSY.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISGYO.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ISMEN.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"ITTFH.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IZFAS.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IZMDC.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"IZTAR.E "}),
-		symbol_tracker_algo::create_new_algo(session, {"JANTS.E "}),
+		create_algo({"ACSEL.E ", "AKBNK.E ", "GARAN.E ", "HALKB.E "}),
+		create_algo({"ADEL.E  "}),
+		create_algo({"ADESE.E "}),
+		create_algo({"AEFES.E "}),
+		create_algo({"AFYON.E "}),
+		create_algo({"AGHOL.E "}),
+		create_algo({"AGYO.E  "}),
+		create_algo({"AKBNK.E "}),
+		create_algo({"AKCNS.E "}),
+		create_algo({"AKENR.E "}),
+		create_algo({"AKFGY.E "}),
+		create_algo({"AKGRT.E "}),
+		create_algo({"AKMGY.E "}),
+		create_algo({"AKSA.E  "}),
+		create_algo({"AKSEN.E "}),
+		create_algo({"AKSGY.E "}),
+		create_algo({"AKSUE.E "}),
+		create_algo({"AKYHO.E "}),
+		create_algo({"ALARK.E "}),
+		create_algo({"ALBRK.E "}),
+		create_algo({"ALCAR.E "}),
+		create_algo({"ALCTL.E "}),
+		create_algo({"ALGYO.E "}),
+		create_algo({"ALKA.E  "}),
+		create_algo({"ALKIM.E "}),
+		create_algo({"ANELE.E "}),
+		create_algo({"ANHYT.E "}),
+		create_algo({"ANSGR.E "}),
+		create_algo({"ARCLK.E "}),
+		create_algo({"ARDYZ.E "}),
+		create_algo({"ARENA.E "}),
+		create_algo({"ARMDA.E "}),
+		create_algo({"ARSAN.E "}),
+		create_algo({"ASELS.E "}),
+		create_algo({"ASUZU.E "}),
+		create_algo({"ATAGY.E "}),
+		create_algo({"ATEKS.E "}),
+		create_algo({"AVGYO.E "}),
+		create_algo({"AVHOL.E "}),
+		create_algo({"AVISA.E "}),
+		create_algo({"AVOD.E  "}),
+		create_algo({"AVTUR.E "}),
+		create_algo({"AYCES.E "}),
+		create_algo({"AYEN.E  "}),
+		create_algo({"AYGAZ.E "}),
+		create_algo({"BAGFS.E "}),
+		create_algo({"BAKAB.E "}),
+		create_algo({"BANVT.E "}),
+		create_algo({"BAYRK.E "}),
+		create_algo({"BERA.E  "}),
+		create_algo({"BEYAZ.E "}),
+		create_algo({"BFREN.E "}),
+		create_algo({"BIMAS.E "}),
+		create_algo({"BIZIM.E "}),
+		create_algo({"BJKAS.E "}),
+		create_algo({"BLCYT.E "}),
+		create_algo({"BNTAS.E "}),
+		create_algo({"BOSSA.E "}),
+		create_algo({"BRISA.E "}),
+		create_algo({"BRKSN.E "}),
+		create_algo({"BRMEN.E "}),
+		create_algo({"BRSAN.E "}),
+		create_algo({"BRYAT.E "}),
+		create_algo({"BSOKE.E "}),
+		create_algo({"BTCIM.E "}),
+		create_algo({"BUCIM.E "}),
+		create_algo({"BURCE.E "}),
+		create_algo({"BURVA.E "}),
+		create_algo({"CCOLA.E "}),
+		create_algo({"CELHA.E "}),
+		create_algo({"CEMAS.E "}),
+		create_algo({"CEMTS.E "}),
+		create_algo({"CEOEM.E "}),
+		create_algo({"CIMSA.E "}),
+		create_algo({"CLEBI.E "}),
+		create_algo({"CMBTN.E "}),
+		create_algo({"CMENT.E "}),
+		create_algo({"CRDFA.E "}),
+		create_algo({"CRFSA.E "}),
+		create_algo({"CUSAN.E "}),
+		create_algo({"DAGHL.E "}),
+		create_algo({"DAGI.E  "}),
+		create_algo({"DERAS.E "}),
+		create_algo({"DERIM.E "}),
+		create_algo({"DESA.E  "}),
+		create_algo({"DESPC.E "}),
+		create_algo({"DEVA.E  "}),
+		create_algo({"DGATE.E "}),
+		create_algo({"DGGYO.E "}),
+		create_algo({"DGKLB.E "}),
+		create_algo({"DITAS.E "}),
+		create_algo({"DMSAS.E "}),
+		create_algo({"DNISI.E "}),
+		create_algo({"DOAS.E  "}),
+		create_algo({"DOBUR.E "}),
+		create_algo({"DOCO.E  "}),
+		create_algo({"DOGUB.E "}),
+		create_algo({"DOHOL.E "}),
+		create_algo({"DOKTA.E "}),
+		create_algo({"DURDO.E "}),
+		create_algo({"DYOBY.E "}),
+		create_algo({"DZGYO.E "}),
+		create_algo({"ECILC.E "}),
+		create_algo({"ECZYT.E "}),
+		create_algo({"EDIP.E  "}),
+		create_algo({"EGEEN.E "}),
+		create_algo({"EGGUB.E "}),
+		create_algo({"EGPRO.E "}),
+		create_algo({"EGSER.E "}),
+		create_algo({"EKGYO.E "}),
+		create_algo({"EMKEL.E "}),
+		create_algo({"ENJSA.E "}),
+		create_algo({"ENKAI.E "}),
+		create_algo({"ERBOS.E "}),
+		create_algo({"EREGL.E "}),
+		create_algo({"ERSU.E  "}),
+		create_algo({"ESCOM.E "}),
+		create_algo({"ESEN.E  "}),
+		create_algo({"EUHOL.E "}),
+		create_algo({"FADE.E  "}),
+		create_algo({"FENER.E "}),
+		create_algo({"FLAP.E  "}),
+		create_algo({"FMIZP.E "}),
+		create_algo({"FONET.E "}),
+		create_algo({"FORMT.E "}),
+		create_algo({"FROTO.E "}),
+		create_algo({"GARAN.E "}),
+		create_algo({"GARFA.E "}),
+		create_algo({"GEDIK.E "}),
+		create_algo({"GEDZA.E "}),
+		create_algo({"GENTS.E "}),
+		create_algo({"GEREL.E "}),
+		create_algo({"GLBMD.E "}),
+		create_algo({"GLRYH.E "}),
+		create_algo({"GLYHO.E "}),
+		create_algo({"GOLTS.E "}),
+		create_algo({"GOODY.E "}),
+		create_algo({"GOZDE.E "}),
+		create_algo({"GSDDE.E "}),
+		create_algo({"GSDHO.E "}),
+		create_algo({"GSRAY.E "}),
+		create_algo({"GUBRF.E "}),
+		create_algo({"HALKB.E "}),
+		create_algo({"HATEK.E "}),
+		create_algo({"HDFGS.E "}),
+		create_algo({"HEKTS.E "}),
+		create_algo({"HLGYO.E "}),
+		create_algo({"HUBVC.E "}),
+		create_algo({"HURGZ.E "}),
+		create_algo({"ICBCT.E "}),
+		create_algo({"IDEAS.E "}),
+		//create_algo({"IDGYO.E "}),
+		create_algo({"IEYHO.E "}),
+		create_algo({"IHEVA.E "}),
+		create_algo({"IHGZT.E "}),
+		create_algo({"IHLAS.E "}),
+		create_algo({"IHLGM.E "}),
+		create_algo({"IHYAY.E "}),
+		create_algo({"INDES.E "}),
+		create_algo({"INFO.E  "}),
+		create_algo({"INTEM.E "}),
+		create_algo({"INVEO.E "}),
+		create_algo({"IPEKE.E "}),
+		create_algo({"ISATR.E "}),
+		create_algo({"ISBTR.E "}),
+		create_algo({"ISCTR.E "}),
+		create_algo({"ISDMR.E "}),
+		create_algo({"ISFIN.E "}),
+		create_algo({"ISGSY.E "}),
+		create_algo({"ISGYO.E "}),
+		create_algo({"ISMEN.E "}),
+		create_algo({"ITTFH.E "}),
+		create_algo({"IZFAS.E "}),
+		create_algo({"IZMDC.E "}),
+		create_algo({"IZTAR.E "}),
+		create_algo({"JANTS.E "}),
 	};
 
+	// coroutine algos share the same workers
+	std::vector<std::unique_ptr<sweep_recovery_algo>> sweep_algos;
+	for (auto symbol : { "AKBNK.E ", "GARAN.E ", "HALKB.E ", "ISCTR.E " }) {
+		sweep_algos.push_back(std::make_unique<sweep_recovery_algo>(session, symbol, scheduler));
+		sweep_algos.back()->start();
+	}
+
+	if (argc > 2) {
+		print_thread_placement("feed");
+		std::mutex print_mutex;
+		scheduler.run_on_workers([&print_mutex](size_t i) {
+			std::lock_guard<std::mutex> lock(print_mutex);
+			print_thread_placement("algo worker " + std::to_string(i));
+		});
+	}
+
 	std::chrono::nanoseconds nmap_dur;
 	auto perf_start = clock_type::now();
 
@@ -230,9 +279,15 @@ int main(int argc, char* argv[])
 			p += nr;
 			size -= nr;
 		}
+		session->flush();
 	}
 	//session->stop();
 	//std::this_thread::sleep_for(std::chrono::seconds(100));
+	for (auto&& algo : sweep_algos) {
+		algo->stop();
+		std::cout << algo->symbol() << " sweeps recovered within 5 ms: " << algo->recovered() << "/" << algo->sweeps() << std::endl;
+	}
+	sweep_algos.clear();
 	for (auto&& algo : algos) {
 		delete algo;
 	}
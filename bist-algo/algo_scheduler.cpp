@@ -0,0 +1,103 @@
+#include "algo_scheduler.h"
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_future.hpp>
+#include <condition_variable>
+#include <future>
+#include <stdexcept>
+
+namespace helix
+{
+	algo_scheduler::algo_scheduler(size_t workers, std::vector<thread_placement> placements)
+		: _worker_count(workers)
+		, _workers(workers)
+	{
+		if (workers == 0) {
+			throw std::invalid_argument("algo scheduler needs at least one worker");
+		}
+		run_on_workers([&placements](size_t i) {
+			if (i < placements.size()) {
+				pin_current_thread(placements[i]);
+			}
+		});
+	}
+
+	algo_scheduler::~algo_scheduler()
+	{
+		join();
+	}
+
+	algo_scheduler::strand_type algo_scheduler::make_strand()
+	{
+		return strand_type{ _workers.get_executor() };
+	}
+
+	algo_scheduler::strand_type algo_scheduler::make_dedicated_strand(thread_placement placement)
+	{
+		auto worker = std::make_unique<boost::asio::thread_pool>(1);
+		pin_thread_pool(*worker, placement);
+		std::lock_guard<std::mutex> lock(_dedicated_mutex);
+		_dedicated.push_back(std::move(worker));
+		return strand_type{ _dedicated.back()->get_executor() };
+	}
+
+	void algo_scheduler::release_dedicated_worker(const executor_type& worker)
+	{
+		std::unique_ptr<boost::asio::thread_pool> released;
+		{
+			std::lock_guard<std::mutex> lock(_dedicated_mutex);
+			auto it = std::find_if(_dedicated.begin(), _dedicated.end(), [&worker](const auto& w) {
+				return w->get_executor() == worker;
+			});
+			if (it == _dedicated.end()) {
+				throw std::invalid_argument("not a dedicated worker of the scheduler");
+			}
+			released = std::move(*it);
+			_dedicated.erase(it);
+		}
+		released->join();
+	}
+
+	size_t algo_scheduler::dedicated_worker_count() const
+	{
+		std::lock_guard<std::mutex> lock(_dedicated_mutex);
+		return _dedicated.size();
+	}
+
+	void algo_scheduler::run_on_workers(const std::function<void(size_t)>& fun)
+	{
+		std::mutex mutex;
+		std::condition_variable all_arrived;
+		size_t arrived = 0;
+		std::vector<std::future<void>> done;
+		for (size_t i = 0; i < _worker_count; i++) {
+			done.push_back(boost::asio::post(_workers, boost::asio::use_future([&, i] {
+				// hold every worker until all of them took a task, so that no worker runs two
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					arrived++;
+					all_arrived.notify_all();
+					all_arrived.wait(lock, [&] { return arrived == _worker_count; });
+				}
+				fun(i);
+			})));
+		}
+		// the tasks refer to the locals above, so let all of them finish before throwing
+		for (auto& f : done) {
+			f.wait();
+		}
+		for (auto& f : done) {
+			f.get();
+		}
+	}
+
+	void algo_scheduler::join()
+	{
+		_workers.join();
+		std::lock_guard<std::mutex> lock(_dedicated_mutex);
+		for (auto& worker : _dedicated) {
+			worker->join();
+		}
+	}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <thread_topology.hh>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+namespace helix
+{
+	/*
+	runs the events of many algos on a fixed set of worker threads, instead of a thread per algo
+	contending for a few cores. every algo gets a strand of its own, so its tick() never runs on
+	two workers at once and needs no locking, while an idle worker picks up whichever algo has
+	an event queued next.
+
+	hot algos can ask for a dedicated worker pinned to a cpu of their own, which no other algo
+	runs on.
+	*/
+	class algo_scheduler
+	{
+	public:
+		using executor_type = boost::asio::thread_pool::executor_type;
+		using strand_type = boost::asio::strand<executor_type>;
+
+		// worker i is pinned to placements[i], the ones past the list are left unpinned
+		explicit algo_scheduler(size_t workers, std::vector<thread_placement> placements = {});
+		~algo_scheduler();
+
+		algo_scheduler(const algo_scheduler&) = delete;
+		algo_scheduler& operator=(const algo_scheduler&) = delete;
+
+		// a strand on the shared workers
+		strand_type make_strand();
+
+		// a strand on a new worker pinned to placement, for an algo too hot to share
+		strand_type make_dedicated_strand(thread_placement placement);
+
+		// waits for the work queued on the worker of a make_dedicated_strand() strand and stops
+		// it. call it once nothing refers to the strand any more
+		void release_dedicated_worker(const executor_type& worker);
+
+		size_t dedicated_worker_count() const;
+
+		size_t worker_count() const {
+			return _worker_count;
+		}
+
+		// runs fun(i) once on every shared worker i and waits until all of them return
+		void run_on_workers(const std::function<void(size_t)>& fun);
+
+		// waits for the queued events to run and stops all workers
+		void join();
+	private:
+		size_t _worker_count;
+		boost::asio::thread_pool _workers;
+		mutable std::mutex _dedicated_mutex;
+		std::vector<std::unique_ptr<boost::asio::thread_pool>> _dedicated;
+	};
+
+} // namespace helix.
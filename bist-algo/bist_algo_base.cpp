@@ -1,54 +1,173 @@
 #include "bist_algo_base.h"
 #include <boost/asio/io_context.hpp>
 #include <algorithm>
+#include <future>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace helix
 {
-	algo_base::algo_base(std::weak_ptr<session> s)
+	// tells the core a busy-wait loop is spinning, which frees pipeline resources for a sibling
+	// hyperthread and saves power
+	static inline void cpu_relax()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+
+	algo_base::algo_base(std::weak_ptr<session> s, thread_placement placement, event_loop_options loop)
 		: _session(std::move(s))
+		, _loop(loop)
+	{
+		if (_loop.wait == event_wait::block) {
+			_pool = std::make_unique<thread_pool>(1);
+			_strand.emplace(_pool->get_executor());
+			pin_thread_pool(*_pool, placement);
+		} else {
+			_inbox = std::make_unique<event_inbox>();
+			// the poller pins itself before it polls, a placement the os refuses is thrown here
+			std::promise<void> pinned;
+			auto pinning = pinned.get_future();
+			_poller = std::thread{ [this, placement, &pinned] {
+				try {
+					pin_current_thread(placement);
+				} catch (...) {
+					pinned.set_exception(std::current_exception());
+					return;
+				}
+				pinned.set_value();
+				poll_events();
+			} };
+			try {
+				pinning.get();
+			} catch (...) {
+				_poller.join();
+				throw;
+			}
+		}
+		_working = true;
+	}
+
+	algo_base::algo_base(std::weak_ptr<session> s, algo_scheduler& scheduler, thread_placement placement)
+		: _strand(std::in_place, placement.pinned() ? scheduler.make_dedicated_strand(placement) : scheduler.make_strand())
+		, _dedicated_scheduler(placement.pinned() ? &scheduler : nullptr)
+		, _session(std::move(s))
 	{
 		_working = true;
 	}
-	algo_base::~algo_base() = default;
+
+	algo_base::~algo_base()
+	{
+		join_events();
+		if (_dedicated_scheduler) {
+			// the strand refers to its worker, so it goes first
+			auto worker = _strand->get_inner_executor();
+			_strand.reset();
+			_dedicated_scheduler->release_dedicated_worker(worker);
+		}
+	}
+
+	void algo_base::join_events()
+	{
+		if (_strand && _strand->running_in_this_thread()) {
+			// the tick() that called would wait for itself
+			throw std::logic_error("join_events() called from the algo's own strand");
+		}
+		_stopping.store(true);
+		while (_in_flight.load() != 0) {
+			std::this_thread::yield();
+		}
+		if (_pool) {
+			_pool->join();
+		}
+		if (_poller.joinable()) {
+			_parking.wake();
+			_poller.join();
+		}
+	}
+
+	void algo_base::post_to_inbox(const event& ev)
+	{
+		while (!_inbox->try_push(ev)) {
+			// the algo is a full inbox behind
+			std::this_thread::yield();
+		}
+		if (_loop.wait == event_wait::hybrid) {
+			_parking.wake();
+		}
+	}
+
+	void algo_base::poll_events()
+	{
+		auto tick_event = [this](const event& ev) {
+			auto copy = ev;
+			tick(&copy);
+		};
+		constexpr uint32_t max_pauses = 64;
+		uint32_t pauses = 1;
+		for (;;) {
+			if (_inbox->consume(tick_event)) {
+				pauses = 1;
+				continue;
+			}
+			if (_stopping.load() && _inbox->empty()) {
+				return;
+			}
+			switch (_loop.wait) {
+			case event_wait::spin:
+				break;
+			case event_wait::backoff:
+				for (uint32_t i = 0; i < pauses; i++) {
+					cpu_relax();
+				}
+				pauses = std::min(pauses * 2, max_pauses);
+				break;
+			case event_wait::hybrid:
+			default:
+				_parking.wait([this] { return !_inbox->empty() || _stopping.load(); }, _loop.spin_time);
+				break;
+			}
+		}
+	}
 
 	void algo_base::create_ob_with_symbols(std::vector<std::pair<std::string, size_t>> symbols)
 	{
 		ob_sym_map.reserve(symbols.size());
 		for (const auto& [symb, max_order] : symbols) {
-			ob_sym_map.insert({symb, order_book{symb, 0, max_order} });
-			auto& ob = ob_sym_map.at(symb);
-			get_session()->register_for_symbol(symb, std::make_unique<order_book_agent>(&_pool, &ob));
+			auto book = get_session()->share_book(symb, max_order);
+			if (!book) {
+				throw std::invalid_argument("session cannot share the book of " + symb);
+			}
+			ob_sym_map.insert({symb, book });
 			register_callback(symb);
 		}
 	}
 
-	helix::order_book* algo_base::get_ob_for_sym(std::string sym) {
-		if (auto it = ob_sym_map.find(sym);
-				it != ob_sym_map.end())
-		{
-			return std::addressof(it->second);
-		}
-		return nullptr;
-	}
-
-	helix::order_book const* algo_base::get_ob_for_sym(std::string sym) const
+	helix::book_publisher const* algo_base::get_ob_for_sym(std::string sym) const
 	{
 		if (auto it = ob_sym_map.find(sym);
 				it != ob_sym_map.end())
 		{
-			return std::addressof(it->second);
+			return it->second;
 		}
 		return nullptr;
 	}
 
-	// will call run() loop after initializing order book handler and registering for necessary events
+	// marks the algo as working, coroutine_algo starts run() on top of it
 	void algo_base::start() {
 		_working = true;
 	}
 
 	// will terminate loop as soon as possible and return the algo to idle state
 	void algo_base::stop() {
-		_pool.join();
+		join_events();
 		_working = false;
 	}
 
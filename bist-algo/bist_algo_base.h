@@ -1,7 +1,15 @@
 #pragma once
 
+#include "algo_scheduler.h"
 #include <helix.hh>
-#include <order_book.hh>
+#include <book_snapshot.hh>
+#include <spsc_ring.hh>
+#include <thread_topology.hh>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
 #include <boost/asio/thread_pool.hpp>
@@ -13,6 +21,24 @@ using boost::asio::use_future;
 
 namespace helix
 {
+	// how the algo thread waits for its next event
+	enum class event_wait {
+		// sleeps in the event pool and is woken per event (default)
+		block,
+		// busy-waits on the inbox
+		spin,
+		// busy-waits on the inbox with cpu pauses that grow while it stays empty
+		backoff,
+		// yields for spin_time, then parks until the next event
+		hybrid,
+	};
+
+	struct event_loop_options {
+		event_wait wait{ event_wait::block };
+		// how long the hybrid loop spins before it parks
+		std::chrono::microseconds spin_time{ 50 };
+	};
+
 	/*
 	btn algoritmalar iin base snf tanmlamas
 	mimari olarak her algoritma bir ekirdekte ve o ekirdek ierisinde tek bir thread zerinde koacaktr
@@ -50,10 +76,16 @@ namespace helix
 	class algo_base
 	{
 	public:
-		algo_base(std::weak_ptr<session> s);
+		// the algo thread is pinned to placement before the algo sees any event
+		algo_base(std::weak_ptr<session> s, thread_placement placement = {}, event_loop_options loop = {});
+
+		// the algo shares the workers of scheduler with other algos, or takes a worker of its own
+		// pinned to placement if one is given
+		algo_base(std::weak_ptr<session> s, algo_scheduler& scheduler, thread_placement placement = {});
 		virtual ~algo_base();
 
-		// will call run() loop after initializing order book handler and registering for necessary events
+		// marks the algo as working. tick() algos get events as soon as they register for them,
+		// coroutine algos start run() here, see coroutine_algo
 		virtual void start();
 		
 		// will terminate loop as soon as possible and return the algo to idle state
@@ -62,15 +94,26 @@ namespace helix
 		// will schedule algo for given event or time to either run algo or do whatever its possible
 		virtual void schedule(/*schedule time or event would be here*/) { }
 
-		thread_pool* get_event_pool() const {
-			return &_pool;
+		// tick() runs in this strand, so anything posted to it runs between events. algos that
+		// poll their inbox run tick() on a thread of their own and have no strand
+		algo_scheduler::strand_type get_executor() const {
+			if (!_strand) {
+				throw std::logic_error("a polling algo has no executor");
+			}
+			return *_strand;
 		}
 
+		// waits for the events handed to the algo so far and stops its thread. derived algos
+		// call it in their destructor, before anything tick() uses is destroyed. it waits for
+		// tick() to return, so it throws std::logic_error if called from the algo's own strand
+		void join_events();
+
 		// all algo's should implement tick(). caclulation steps in every algorithm would be done in this thick event
 		virtual int tick(event* ev) = 0;
 
-		helix::order_book const* get_ob_for_sym(std::string sym) const;
-		helix::order_book* get_ob_for_sym(std::string sym);
+		// the book of a symbol is built once by the session and shared by all algos. nullptr for
+		// symbols the algo did not create a book for
+		helix::book_publisher const* get_ob_for_sym(std::string sym) const;
 	protected:
 		std::shared_ptr<session> get_session();
 		std::shared_ptr<session> get_session() const;
@@ -78,26 +121,65 @@ namespace helix
 		void register_callback(std::string symbol)
 		{
 			auto session = _session.lock();
+			if (_loop.wait != event_wait::block && session->calls_back_concurrently()) {
+				throw std::invalid_argument("a polling algo needs a session that calls back on one thread");
+			}
 			session->register_event(
 				symbol,
 				[this](std::shared_ptr<helix::event> ev)
 				{
-					// use internal event pool to trampoline event_handled in algo thread.
-					dispatch(_pool, boost::bind(&algo_base::event_handled, this, ev));
+					// counted so that join_events() knows when no handler refers to the algo any more
+					_in_flight.fetch_add(1);
+					if (_stopping.load()) {
+						// nothing takes events from a stopped algo, a full inbox would never drain
+						_in_flight.fetch_sub(1);
+						return;
+					}
+					if (_loop.wait == event_wait::block) {
+						// use the strand to trampoline event_handled in algo thread.
+						dispatch(*_strand, [this, ev = std::move(ev)] {
+							event_handled(ev);
+							_in_flight.fetch_sub(1);
+						});
+					} else {
+						post_to_inbox(*ev);
+						_in_flight.fetch_sub(1);
+					}
 				});
 		}
+		// shares the books of symbols and registers for their events. throws std::invalid_argument
+		// if the session cannot share books
 		virtual void create_ob_with_symbols(std::vector<std::pair<std::string, size_t>> symbols);
-
-		// all algo's should implement tick() loop and all the things will go under this loop
-		virtual int run() { return 0; } // run bi dursun imdilik. boost thread pool olunca gerek kalmad sanki.
 	private:
-		std::unordered_map<std::string, helix::order_book> ob_sym_map;
+		std::unordered_map<std::string, helix::book_publisher const*> ob_sym_map;
 
 		// for event_callback register
 		void event_handled(std::shared_ptr<event> ev);
+
+		// polling event loop, used unless the algo blocks in the event pool. events are copied
+		// into a lock-free inbox that the algo thread polls, so handing one over takes no lock
+		// and no wake up unless the thread parked. the inbox has a single producer: the
+		// session must call back on one thread, as itch_bist_handler does, and
+		// register_callback() throws for sessions that call back concurrently.
+		using event_inbox = spsc_ring<event, 4096>;
+		void post_to_inbox(const event& ev);
+		void poll_events();
+
 		bool _working {false};
-		mutable thread_pool _pool{ 1 };
+		// thread of an algo created without a scheduler that blocks in the event pool
+		std::unique_ptr<thread_pool> _pool;
+		std::optional<algo_scheduler::strand_type> _strand;
+		// scheduler that gave the strand a worker of its own, released with the algo
+		algo_scheduler* _dedicated_scheduler{ nullptr };
 		std::weak_ptr<session> _session;
+		event_loop_options _loop;
+		// events handed to the strand that did not run yet, or being copied into the inbox
+		std::atomic<size_t> _in_flight{ 0 };
+		std::unique_ptr<event_inbox> _inbox;
+		std::thread _poller;
+		std::atomic<bool> _stopping{ false };
+		// parking of the hybrid loop
+		parking_spot _parking;
 	};
 
 
@@ -0,0 +1,207 @@
+#include "coroutine_algo.h"
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_future.hpp>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace helix
+{
+	void* coroutine_algo::wake_arena::allocate(size_t size)
+	{
+		if (size <= slot_size) {
+			for (size_t i = 0; i < slot_count; i++) {
+				if (!_used[i].load(std::memory_order_relaxed) && !_used[i].exchange(true, std::memory_order_acquire)) {
+					return _slots[i];
+				}
+			}
+		}
+		return ::operator new(size);
+	}
+
+	void coroutine_algo::wake_arena::deallocate(void* p)
+	{
+		for (size_t i = 0; i < slot_count; i++) {
+			if (p == _slots[i]) {
+				_used[i].store(false, std::memory_order_release);
+				return;
+			}
+		}
+		::operator delete(p);
+	}
+
+	coroutine_algo::coroutine_algo(std::weak_ptr<session> s, algo_scheduler& scheduler, thread_placement placement)
+		: algo_base(std::move(s), scheduler, placement)
+		, _inbox(std::make_unique<event_inbox>())
+		, _wake_arena(std::make_unique<wake_arena>())
+		, _timer(get_executor())
+	{
+	}
+
+	coroutine_algo::~coroutine_algo()
+	{
+		stop_run();
+	}
+
+	void coroutine_algo::start()
+	{
+		algo_base::start();
+		boost::asio::post(get_executor(), [this] {
+			if (!_task.handle() && !_closing.load()) {
+				_task = run();
+				resume(_task.handle());
+			}
+		});
+	}
+
+	void coroutine_algo::stop()
+	{
+		stop_run();
+		algo_base::stop();
+		auto task = std::move(_task);
+		if (auto h = task.handle(); h && h.done() && h.promise().error) {
+			std::rethrow_exception(h.promise().error);
+		}
+	}
+
+	void coroutine_algo::stop_run()
+	{
+		_closing.store(true);
+		while (_posting.load() != 0) {
+			std::this_thread::yield();
+		}
+		// the strand runs one handler at a time, so once a handler of its own finds no drain and
+		// no timer pending, run() took every queued event it waited for and nothing else refers
+		// to it
+		bool pending = true;
+		while (pending) {
+			pending = boost::asio::post(get_executor(), boost::asio::use_future([this] {
+				_timer.cancel();
+				return _drain_scheduled.scheduled() || _timer_pending;
+			})).get();
+		}
+		// keep a finished run() for stop() to rethrow what ended it
+		if (_task.running()) {
+			_task = algo_task{};
+		}
+	}
+
+	void coroutine_algo::subscribe(std::string symbol)
+	{
+		auto session = get_session();
+		if (session->calls_back_concurrently()) {
+			throw std::invalid_argument("a coroutine algo needs a session that calls back on one thread");
+		}
+		session->register_event(std::move(symbol), [this](std::shared_ptr<event> ev) {
+			post_event(*ev);
+		});
+	}
+
+	int coroutine_algo::tick(event* ev)
+	{
+		deliver(*ev);
+		return 0;
+	}
+
+	void coroutine_algo::post_event(const event& ev)
+	{
+		// counted so that stop_run() knows when the session no longer touches the inbox
+		_posting.fetch_add(1);
+		if (!_closing.load()) {
+			bool pushed = _inbox->try_push(ev);
+			// run() is behind; make sure it is draining and give it a moment to make room, but
+			// never hold the feed up for longer than that
+			for (size_t retry = 0; !pushed && retry < push_retries && _listening.load(std::memory_order_relaxed); retry++) {
+				schedule_drain();
+				std::this_thread::yield();
+				pushed = _inbox->try_push(ev);
+			}
+			if (pushed) {
+				schedule_drain();
+			} else {
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		_posting.fetch_sub(1);
+	}
+
+	void coroutine_algo::schedule_drain()
+	{
+		if (_drain_scheduled.try_claim()) {
+			boost::asio::post(get_executor(), drain_handler{ this });
+		}
+	}
+
+	void coroutine_algo::drain()
+	{
+		size_t delivered = 0;
+		while (_awaiting && delivered < drain_batch
+			&& _inbox->consume([this](const event& ev) { deliver(ev); }, 1)) {
+			delivered++;
+		}
+		if (!_task.running()) {
+			// nothing will read them
+			_inbox->consume([](const event&) {});
+		}
+		if (_awaiting && !_inbox->empty()) {
+			// let the other algos of the strand's worker run between batches
+			boost::asio::post(get_executor(), drain_handler{ this });
+			return;
+		}
+		// an event pushed while the flag was still set did not post a drain
+		_drain_scheduled.release();
+		if ((_awaiting || !_task.running()) && !_inbox->empty()) {
+			schedule_drain();
+		}
+	}
+
+	void coroutine_algo::deliver(const event& ev)
+	{
+		if (!_awaiting) {
+			return;
+		}
+		auto symbol = ev.get_symbol();
+		if (!_awaited_symbol.empty() && !symbol.empty() && symbol != _awaited_symbol) {
+			return;
+		}
+		_current = &ev;
+		resume(std::exchange(_awaiting, {}));
+		_current = nullptr;
+	}
+
+	void coroutine_algo::resume(std::coroutine_handle<> h)
+	{
+		_listening.store(true, std::memory_order_relaxed);
+		h.resume();
+		if (!_task.running()) {
+			_listening.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	void coroutine_algo::event_awaiter::await_suspend(std::coroutine_handle<> h)
+	{
+		algo->_awaiting = h;
+		algo->_awaited_symbol = symbol;
+		if (!algo->_inbox->empty()) {
+			algo->schedule_drain();
+		}
+	}
+
+	void coroutine_algo::timer_awaiter::await_suspend(std::coroutine_handle<> h)
+	{
+		algo->_listening.store(false, std::memory_order_relaxed);
+		algo->_timer_pending = true;
+		algo->_timer.expires_after(duration);
+		algo->_timer.async_wait(timer_handler{ algo, h });
+	}
+
+	void coroutine_algo::timer_handler::operator()(const boost::system::error_code& ec) const
+	{
+		algo->_timer_pending = false;
+		// a stopping algo does not wake up from timers
+		if (!ec && !algo->_closing.load()) {
+			algo->resume(h);
+		}
+	}
+
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "bist_algo_base.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <boost/asio/steady_timer.hpp>
+
+namespace helix
+{
+	// coroutine returned by coroutine_algo::run(). it is created suspended and the algo owns it
+	// and resumes it in its strand.
+	class algo_task
+	{
+	public:
+		struct promise_type {
+			std::exception_ptr error;
+
+			algo_task get_return_object() {
+				return algo_task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+			}
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { error = std::current_exception(); }
+		};
+
+		algo_task() = default;
+		algo_task(algo_task&& other) noexcept
+			: _handle(std::exchange(other._handle, {})) { }
+		algo_task& operator=(algo_task&& other) noexcept {
+			if (this != &other) {
+				if (_handle) {
+					_handle.destroy();
+				}
+				_handle = std::exchange(other._handle, {});
+			}
+			return *this;
+		}
+		~algo_task() {
+			if (_handle) {
+				_handle.destroy();
+			}
+		}
+
+		std::coroutine_handle<promise_type> handle() const {
+			return _handle;
+		}
+
+		// true from the start of the coroutine until it returns
+		bool running() const {
+			return _handle && !_handle.done();
+		}
+	private:
+		explicit algo_task(std::coroutine_handle<promise_type> handle)
+			: _handle(handle) { }
+
+		std::coroutine_handle<promise_type> _handle;
+	};
+
+	/*
+	algo written as one sequential coroutine instead of tick() callbacks:
+
+		algo_task run() override {
+			for (;;) {
+				const event& ev = co_await next_event("GARAN.E ");
+				...
+				co_await timer(std::chrono::milliseconds(5));
+			}
+		}
+
+	run() is resumed in the algo's strand on the workers of an algo_scheduler, so hundreds of
+	algos share a few pinned threads and each of them still runs on one thread at a time.
+	events are copied into a lock-free inbox and the strand is only posted to when the algo
+	is idle, so an event costs no heap allocation and a burst of events costs one post. the
+	inbox has a single producer: the session must call back on one thread, as
+	itch_bist_handler does. subscribe() throws for sessions that call back concurrently.
+	*/
+	class coroutine_algo : public algo_base
+	{
+	public:
+		coroutine_algo(std::weak_ptr<session> s, algo_scheduler& scheduler, thread_placement placement = {});
+		~coroutine_algo() override;
+
+		// starts run() in the algo's strand
+		void start() override;
+
+		// stops run() and rethrows the exception that ended it, if any
+		void stop() override;
+
+		// events that came when the inbox was full, or when run() was not running. while run()
+		// only falls behind the session waits push_retries yields for room before it drops one.
+		size_t dropped_events() const {
+			return _dropped.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		struct event_awaiter {
+			coroutine_algo* algo;
+			std::string_view symbol;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> h);
+			const event& await_resume() const noexcept { return *algo->_current; }
+		};
+
+		struct timer_awaiter {
+			coroutine_algo* algo;
+			std::chrono::nanoseconds duration;
+
+			bool await_ready() const noexcept { return duration.count() <= 0; }
+			void await_suspend(std::coroutine_handle<> h);
+			void await_resume() const noexcept { }
+		};
+
+		// the algo itself, a loop over co_await next_event() and co_await timer(). it runs from
+		// start() until it returns or the algo stops.
+		virtual algo_task run() = 0;
+
+		// passes the events of symbol to run(). throws std::invalid_argument if the session
+		// calls back concurrently.
+		void subscribe(std::string symbol);
+
+		// resumes run() with the next event of symbol, or of any symbol if it is empty, and
+		// skips the events of other symbols that come first. events without a symbol, like the
+		// session opening, are passed whatever symbol run() waits for. the event is only valid
+		// until the next co_await; run() must copy what it keeps.
+		event_awaiter next_event(std::string_view symbol = {}) {
+			return event_awaiter{ this, symbol };
+		}
+
+		// resumes run() after duration. events that come meanwhile are queued in the inbox, and
+		// dropped once it is full.
+		timer_awaiter timer(std::chrono::nanoseconds duration) {
+			return timer_awaiter{ this, duration };
+		}
+
+		// passes run() the events queued so far, cancels its timer and destroys it wherever it is
+		// suspended. derived algos call it in their destructor, before anything run() uses is
+		// destroyed.
+		void stop_run();
+
+	private:
+		// memory for the handlers asio allocates to wake the algo, from the feed thread, which has
+		// no handler cache of its own, or from a timer. a wake up is rarely in flight more than
+		// twice, past that it falls back to the heap.
+		class wake_arena {
+		public:
+			static constexpr size_t slot_count = 4;
+			static constexpr size_t slot_size = 256;
+
+			void* allocate(size_t size);
+			void deallocate(void* p);
+		private:
+			alignas(std::max_align_t) unsigned char _slots[slot_count][slot_size];
+			std::atomic<bool> _used[slot_count]{};
+		};
+
+		template<typename T>
+		struct wake_allocator {
+			using value_type = T;
+			wake_arena* arena;
+
+			explicit wake_allocator(wake_arena* a) : arena(a) { }
+			template<typename U>
+			wake_allocator(const wake_allocator<U>& other) : arena(other.arena) { }
+
+			T* allocate(size_t n) {
+				return static_cast<T*>(arena->allocate(n * sizeof(T)));
+			}
+			void deallocate(T* p, size_t) {
+				arena->deallocate(p);
+			}
+			template<typename U>
+			bool operator==(const wake_allocator<U>& other) const { return arena == other.arena; }
+			template<typename U>
+			bool operator!=(const wake_allocator<U>& other) const { return arena != other.arena; }
+		};
+
+		// posted to the strand to pass queued events to run()
+		struct drain_handler {
+			using allocator_type = wake_allocator<void>;
+			coroutine_algo* algo;
+
+			allocator_type get_allocator() const {
+				return allocator_type{ algo->_wake_arena.get() };
+			}
+			void operator()() const {
+				algo->drain();
+			}
+		};
+
+		// resumes run() when its timer expires
+		struct timer_handler {
+			using allocator_type = wake_allocator<void>;
+			coroutine_algo* algo;
+			std::coroutine_handle<> h;
+
+			allocator_type get_allocator() const {
+				return allocator_type{ algo->_wake_arena.get() };
+			}
+			void operator()(const boost::system::error_code& ec) const;
+		};
+
+		using event_inbox = spsc_ring<event, 4096>;
+		static constexpr size_t drain_batch = 256;
+		static constexpr size_t push_retries = 64;
+
+		int tick(event* ev) final;
+		void post_event(const event& ev);
+		void schedule_drain();
+		void drain();
+		void deliver(const event& ev);
+		// resumes run() and notes whether it waits for events when it suspends again
+		void resume(std::coroutine_handle<> h);
+
+		std::unique_ptr<event_inbox> _inbox;
+		std::unique_ptr<wake_arena> _wake_arena;
+		// typed on the strand rather than any_io_executor, which allocates to copy a strand
+		boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+			boost::asio::wait_traits<std::chrono::steady_clock>, algo_scheduler::strand_type> _timer;
+		// state of run(), only touched in the strand
+		std::coroutine_handle<> _awaiting;
+		std::string_view _awaited_symbol;
+		const event* _current{ nullptr };
+		bool _timer_pending{ false };
+		drain_flag _drain_scheduled;
+		std::atomic<bool> _closing{ false };
+		// run() is running and not waiting for a timer, so the inbox is sure to drain
+		std::atomic<bool> _listening{ false };
+		// session callbacks in progress
+		std::atomic<size_t> _posting{ 0 };
+		std::atomic<size_t> _dropped{ 0 };
+		// declared last, so that run() is destroyed before the state it refers to
+		algo_task _task;
+	};
+
+} // namespace helix.
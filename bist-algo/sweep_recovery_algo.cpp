@@ -0,0 +1,59 @@
+#include "sweep_recovery_algo.h"
+#include <stdexcept>
+
+namespace helix
+{
+	sweep_recovery_algo::sweep_recovery_algo(
+		std::weak_ptr<session> s,
+		std::string symbol,
+		algo_scheduler& scheduler,
+		std::chrono::microseconds window,
+		thread_placement placement)
+		: coroutine_algo(std::move(s), scheduler, placement)
+		, _symbol(std::move(symbol))
+		, _window(window)
+		, _top(get_session()->share_top_of_book(_symbol, 1000))
+	{
+		if (!_top) {
+			throw std::invalid_argument("session cannot share the top of book of " + _symbol);
+		}
+		subscribe(_symbol);
+	}
+
+	sweep_recovery_algo::~sweep_recovery_algo()
+	{
+		stop_run();
+	}
+
+	algo_task sweep_recovery_algo::run()
+	{
+		for (;;) {
+			const event& ev = co_await next_event(_symbol);
+			auto mask = ev.get_mask();
+			if (mask & ev_closed) {
+				co_return;
+			}
+			if (!(mask & ev_sweep) || !(mask & ev_trade)) {
+				continue;
+			}
+			// the event is only valid until the next co_await
+			const trade swept = *ev.get_trade();
+			if (swept.sign != trade_sign::buyer_initiated && swept.sign != trade_sign::seller_initiated) {
+				continue;
+			}
+			_sweeps.fetch_add(1, std::memory_order_relaxed);
+
+			// events that come meanwhile wait in the inbox
+			co_await timer(_window);
+
+			const auto top = _top->load();
+			const bool refilled = swept.sign == trade_sign::buyer_initiated
+				? top.ask_size != 0 && top.ask_price <= swept.price
+				: top.bid_size != 0 && top.bid_price >= swept.price;
+			if (refilled) {
+				_recovered.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+}
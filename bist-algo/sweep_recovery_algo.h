@@ -0,0 +1,51 @@
+#pragma once
+
+#include "coroutine_algo.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace helix
+{
+	/*
+	watches the sweeps of a symbol, the trades that take out the last order of a price level, and
+	checks a while after each whether liquidity came back to the swept price:
+
+		sweep at 12.40 by a buyer --- window --- best ask <= 12.40 ? recovered : not recovered
+
+	the sweep comes in as an event, the book after the window is read from the shared top of
+	book, so the algo only wakes up twice per sweep.
+	*/
+	class sweep_recovery_algo final : public coroutine_algo
+	{
+	public:
+		sweep_recovery_algo(std::weak_ptr<session> s, std::string symbol, algo_scheduler& scheduler,
+			std::chrono::microseconds window = std::chrono::milliseconds(5), thread_placement placement = {});
+		~sweep_recovery_algo() override;
+
+		const std::string& symbol() const {
+			return _symbol;
+		}
+
+		size_t sweeps() const {
+			return _sweeps.load(std::memory_order_relaxed);
+		}
+
+		// sweeps whose price level was filled again within the window
+		size_t recovered() const {
+			return _recovered.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		algo_task run() override;
+
+	private:
+		std::string _symbol;
+		std::chrono::microseconds _window;
+		const top_of_book_publisher* _top;
+		std::atomic<size_t> _sweeps{ 0 };
+		std::atomic<size_t> _recovered{ 0 };
+	};
+
+} // namespace helix.
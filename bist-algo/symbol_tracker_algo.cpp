@@ -10,11 +10,6 @@
 namespace helix 
 {
 	struct trace_session {
-		double	  bid_price = 0;
-		uint64_t	bid_size = 0;
-		double	  ask_price = +INFINITY;
-		uint64_t	ask_size = 0;
-
 		size_t max_price_levels = 0;
 		size_t max_order_count = 0;
 		uint64_t quotes = 0;
@@ -55,8 +50,9 @@ namespace helix
 		}
 
 		virtual void fmt_header(void) = 0;
-		virtual void fmt_event(session* session, order_book* ob, event* event) = 0;
+		virtual void fmt_event(session* session, const book_snapshot* ob, event* event) = 0;
 		virtual void fmt_footer(session* session, event* event) {}
+		virtual void fmt_quote(const std::string& symbol, const book_snapshot* ob, const top_of_book& top) {}
 	protected:
 		FILE* output = NULL;
 		bool flush = false;
@@ -75,10 +71,10 @@ namespace helix
 		}
 	}
 
-	static double get_price(order_book* ob, uint64_t price)
+	static double get_price(const book_snapshot* ob, uint64_t price)
 	{
 		double p = 0.0;
-		[[unlikely]] if (auto dec = ob->decimals_for_price();
+		[[unlikely]] if (auto dec = ob->decimals_for_price;
 										 dec == 256)
 		{
 			p = static_cast<double>(price) / 256.0;
@@ -135,13 +131,33 @@ namespace helix
 			}
 		}
 
-		void fmt_event(session* session, order_book* ob, event* event) override
+		void fmt_quote(const std::string& symbol, const book_snapshot* ob, const top_of_book& top) override
+		{
+			fprintf(output, "%s last quote: %" PRIu64 " @ %.3f / %.3f @ %" PRIu64 ", last trade: %" PRIu64 " @ %.3f\n",
+							symbol.c_str(),
+							top.bid_size, get_price(ob, top.bid_price),
+							top.ask_size ? get_price(ob, top.ask_price) : 0.0, top.ask_size,
+							top.last_size, get_price(ob, top.last_price));
+			if (flush) {
+				fflush(output);
+			}
+		}
+
+		void fmt_event(session* session, const book_snapshot* ob, event* event) override
 		{
 			using namespace std::chrono;
 			auto timestamp = event->get_timestamp();
 			if (!session->is_rth_timestamp(timestamp)) {
 				return;
 			}
+			auto event_mask = event->get_mask();
+			// the handler flags book updates that moved the top of the book and carries the new
+			// top in the event. one-sided books are not shown
+			const auto& bbo = event->get_bbo();
+			const bool show_bbo = (event_mask & ev_bbo_changed) && bbo.bid_price && bbo.ask_size;
+			if (!show_bbo && !(event_mask & ev_trade)) {
+				return;
+			}
 			nanoseconds ns(*reinterpret_cast<uint64_t*>(&timestamp));
 			time_point<system_clock, seconds> tp(duration_cast<seconds>(ns));
 			auto tm = system_clock::to_time_t(tp);
@@ -152,43 +168,18 @@ namespace helix
 			const uint64_t seconds = lcltm->tm_sec;
 			const uint64_t milliseconds = timestamp % 1000000;
 
-			auto bid_level = ob->bid_level(0);
-			auto ask_level = ob->ask_level(0);
-
-			auto bid_price = get_price(ob, bid_level.price);
-			auto bid_size  = bid_level.size;
-			auto ask_price = get_price(ob, ask_level.price);
-			auto ask_size  = ask_level.size;
-
-			// buras neden byle mutlaka ren!
-			if (!bid_price || !ask_size) {
-				//fprintf(output, " ___*-*-*-*-*-*-*-*-*-*-*-*___ |");
-				return;
-			}
-
-			const bool has_ob_changed = bid_price != ts.bid_price || 
-																	ask_price != ts.ask_price || 
-																	bid_size  != ts.bid_size  || 
-																	ask_size  != ts.ask_size;
-			if (!has_ob_changed) return;
-
 			fprintf(output, "%s | %02" PRIu64":%02" PRIu64":%02" PRIu64".%06" PRIu64 " |",
 							event->get_symbol().data(),
 							hours, minutes, seconds, milliseconds);
-			auto event_mask = event->get_mask();
 
-			if (event_mask & ev_order_book_update) 
+			if (show_bbo) 
 			{				
 				fprintf(output, "%6" PRIu64"  %6.3f  %6.3f  %-6" PRIu64" |",
-								bid_size,
-								bid_price,
-								ask_price,
-								ask_size
+								bbo.bid_size,
+								get_price(ob, bbo.bid_price),
+								get_price(ob, bbo.ask_price),
+								bbo.ask_size
 				);
-				ts.bid_price = bid_price;
-				ts.bid_size = bid_size;
-				ts.ask_price = ask_price;
-				ts.ask_size = ask_size;
 			}
 			else {
 				fprintf(output, "                               |");
@@ -223,11 +214,11 @@ namespace helix
 		}
 	};
 
-	static void process_ob_event(trace_session* ts, order_book* ob, event_mask event_mask)
+	static void process_ob_event(trace_session* ts, const book_snapshot* ob, event_mask event_mask)
 	{
-		size_t bid_levels = ob->bid_levels();
-		size_t ask_levels = ob->ask_levels();
-		size_t order_count = ob->order_count();
+		size_t bid_levels = ob->bid_levels;
+		size_t ask_levels = ob->ask_levels;
+		size_t order_count = ob->order_count;
 
 		ts->max_price_levels = bid_levels > ts->max_price_levels ? bid_levels : ts->max_price_levels;
 		ts->max_price_levels = ask_levels > ts->max_price_levels ? ask_levels : ts->max_price_levels;
@@ -235,7 +226,7 @@ namespace helix
 		ts->quotes++;
 	}
 
-	static void process_trade_event(trace_session* ts, order_book* ob, trade* trade, event_mask event_mask)
+	static void process_trade_event(trace_session* ts, const book_snapshot* ob, trade* trade, event_mask event_mask)
 	{
 		double trade_price = get_price(ob, trade->price);
 		uint64_t trade_size = trade->size;
@@ -248,16 +239,44 @@ namespace helix
 
   symbol_tracker_algo* symbol_tracker_algo::create_new_algo(
 		std::weak_ptr<session> session, 
-		std::vector<std::string> symbol)
+		std::vector<std::string> symbol,
+		thread_placement placement,
+		event_loop_options loop)
   {
-    return new symbol_tracker_algo(session, std::move(symbol));
+    return new symbol_tracker_algo(session, std::move(symbol), placement, loop);
   }
 
+  symbol_tracker_algo* symbol_tracker_algo::create_new_algo(
+		std::weak_ptr<session> session,
+		std::vector<std::string> symbol,
+		algo_scheduler& scheduler,
+		thread_placement placement)
+  {
+    return new symbol_tracker_algo(session, std::move(symbol), scheduler, placement);
+  }
+
+  symbol_tracker_algo::symbol_tracker_algo(
+		std::weak_ptr<session> s,
+		std::vector<std::string> symbols,
+		thread_placement placement,
+		event_loop_options loop)
+    : algo_base(s, placement, loop)
+  {
+		init(std::move(symbols));
+	}
+
   symbol_tracker_algo::symbol_tracker_algo(
 		std::weak_ptr<session> s,
-		std::vector<std::string> symbols)
-    : algo_base(s)
+		std::vector<std::string> symbols,
+		algo_scheduler& scheduler,
+		thread_placement placement)
+    : algo_base(s, scheduler, placement)
   {
+		init(std::move(symbols));
+	}
+
+	void symbol_tracker_algo::init(std::vector<std::string> symbols)
+	{
 		impl.reset(new fmt_pretty_ops);
 		std::stringstream s_str;
 		s_str << "D:/hft/results/" << "result_" << symbols.front() << ".out";
@@ -268,12 +287,18 @@ namespace helix
 			vec.push_back({ sym, 1000 });
 		}
 		create_ob_with_symbols(std::move(vec));
+		for (auto&& sym : symbols) {
+			// the close footer reads the last quote of each symbol without a lock
+			if (auto top = get_session()->share_top_of_book(sym, 1000)) {
+				_tops.emplace_back(sym, top);
+			}
+		}
 	}
 
 	symbol_tracker_algo::~symbol_tracker_algo() {
 		//_pool.stop();
 		//_pool.join();
-		get_event_pool()->join();
+		join_events();
 		impl.reset();
 	}
 
@@ -284,9 +309,17 @@ namespace helix
 			// TODO(): do whatever when bist opened or closed!
 			puts("bist opened/closed event consumed.");
 			impl->fmt_footer(session.get(), ev);
+			if (mask & ev_closed) {
+				for (const auto& [sym, top] : _tops) {
+					auto snapshot = get_ob_for_sym(sym)->read();
+					impl->fmt_quote(sym, &snapshot, top->load());
+				}
+			}
 			return 0;
 		}
-		auto ob = get_ob_for_sym(ev->get_symbol());
+		// the snapshot may already be ahead of the event, which was queued to this thread
+		auto snapshot = get_ob_for_sym(std::string{ ev->get_symbol() })->read();
+		auto ob = &snapshot;
 		if (mask & ev_order_book_update) {
 			process_ob_event(impl->get_ts(), ob, mask);
 		}
@@ -13,13 +13,25 @@ namespace helix
     public algo_base
   {
   public:
-    explicit symbol_tracker_algo(std::weak_ptr<session> s, std::vector<std::string> symbols);
+    explicit symbol_tracker_algo(std::weak_ptr<session> s, std::vector<std::string> symbols,
+                                 thread_placement placement = {}, event_loop_options loop = {});
+    symbol_tracker_algo(std::weak_ptr<session> s, std::vector<std::string> symbols,
+                        algo_scheduler& scheduler, thread_placement placement = {});
     ~symbol_tracker_algo();
     static symbol_tracker_algo* create_new_algo(std::weak_ptr<session> session, 
-                                                std::vector<std::string> symbol);
+                                                std::vector<std::string> symbol,
+                                                thread_placement placement = {},
+                                                event_loop_options loop = {});
+    static symbol_tracker_algo* create_new_algo(std::weak_ptr<session> session,
+                                                std::vector<std::string> symbol,
+                                                algo_scheduler& scheduler,
+                                                thread_placement placement = {});
   private:
+    void init(std::vector<std::string> symbols);
     int tick(event* ev) override;
     std::unique_ptr<struct trace_fmt_ops> impl;
+    // last quote of each symbol, printed when the market closes
+    std::vector<std::pair<std::string, const top_of_book_publisher*>> _tops;
   };
 
 }
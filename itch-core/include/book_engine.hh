@@ -0,0 +1,233 @@
+#pragma once
+
+/// \file book_engine.hh
+///
+/// Shared storage for the order books of a whole market.
+
+#include "order_table.hh"
+#include "price_ladder.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace helix {
+
+/// \addtogroup order-book
+/// @{
+
+/// \brief Order side.
+enum class side_type : uint8_t {
+    /// Buy order
+    buy = 1,
+    /// Sell order
+    sell = 2,
+};
+
+/// \brief Trading state.
+enum class trading_state : uint8_t {
+    /// Trading state is unknown.
+    unknown,
+    /// Trading is halted.
+    halted,
+    /// Trading is paused.
+    paused,
+    /// Quotation only period.
+    quotation_only,
+    /// Trading is ongoing.
+    trading,
+    /// Auction period.
+    auction,
+};
+
+/// \brief Order is a request to buy or sell quantity of asset at a
+/// specified price.
+struct order final {
+    uint64_t     id;
+    uint64_t     price;
+    uint64_t     quantity;
+    uint64_t     timestamp;
+    side_type    side;
+
+    order(uint64_t id, uint64_t price, uint64_t quantity, side_type side, uint64_t timestamp)
+        : id{id}
+        , price{price}
+        , quantity{quantity}
+        , side{side}
+        , timestamp{timestamp}
+    {}
+};
+
+/// \brief Order record is the compact form the book stores an order in.
+///
+/// ITCH BIST prices are 32-bit and levels are addressed by a level_pool
+/// handle, so a record is half a cache line: the side lives in the top bits
+/// of the level handle and the timestamp is kept out of line, only when the
+/// book is asked to keep it.
+struct order_record final {
+    static constexpr uint32_t npos = price_level::npos;
+
+    uint64_t id;
+    uint64_t quantity;
+    uint32_t price;
+    //! Order table slots of the neighbours in the level queue.
+    uint32_t prev;
+    uint32_t next;
+
+    explicit order_record(const order& o)
+        : id{ o.id }
+        , quantity{ o.quantity }
+        , price{ static_cast<uint32_t>(o.price) }
+        , prev{ npos }
+        , next{ npos }
+        , _level_side{ static_cast<uint32_t>(o.side) << level_bits }
+    { }
+
+    side_type side() const {
+        return static_cast<side_type>(_level_side >> level_bits);
+    }
+
+    level_pool::handle level() const {
+        return _level_side & level_mask;
+    }
+
+    void set_level(level_pool::handle h) {
+        _level_side = (_level_side & ~level_mask) | h;
+    }
+
+private:
+    static constexpr unsigned level_bits = 30;
+    static constexpr uint32_t level_mask = (uint32_t{ 1 } << level_bits) - 1;
+
+    uint32_t _level_side;
+};
+static_assert(sizeof(order_record) == 32, "order record must be 32 bytes");
+static_assert(alignof(order_record) == 8, "order record must pack two per cache line");
+
+/// \brief Order execution details.
+struct execution {
+  //! The price order was executed with.
+  uint64_t price {0};
+  //! The side of the liquidity taker of the trade.
+  side_type side{0};
+  //! The number of remaining quantity on the traded price level.
+  uint64_t remaining{ 0 };
+  bool is_valid{ false };
+  execution() = default;
+  execution(uint64_t price, side_type side, uint64_t remaining);
+  bool valid() const { return is_valid; }
+};
+
+/// \brief Best bid and offer of a book.
+///
+/// The prices of an empty side are those of bid_price() and ask_price(),
+/// zero for the bid and the largest price for the ask.
+struct best_bid_offer {
+  uint64_t bid_price{ 0 };
+  uint64_t bid_size{ 0 };
+  uint64_t ask_price{ UINT64_MAX };
+  uint64_t ask_size{ 0 };
+  //! Incremented by every change of the price or size of the best levels.
+  uint64_t version{ 0 };
+};
+
+/// \brief Book engine keeps the orders and levels of many order books in
+/// storage shared by all of them.
+///
+/// Books are addressed by the 32-bit ITCH OrderBookID and stored at a dense
+/// book index. The per-book state is a structure of arrays indexed by book
+/// index, while the orders of all books share one order table and their
+/// levels one level pool, so a book that is never traded costs a few words
+/// per column instead of its own preallocated tables.
+///
+/// order_book is a view over one book of an engine. The engine is not
+/// thread-safe and must outlive its views.
+class book_engine {
+public:
+    using book_index = uint32_t;
+    static constexpr book_index npos = ~book_index{ 0 };
+
+    /// \param max_orders number of live orders across all books to
+    ///        preallocate for; add_book() grows it by the orders of the book.
+    /// \param resource memory resource for the orders, levels and books.
+    explicit book_engine(size_t max_orders = 0,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    book_engine(const book_engine&) = delete;
+    book_engine& operator=(const book_engine&) = delete;
+
+    /// \brief Adds a book and returns its index.
+    ///
+    /// An OrderBookID that already has a book (ids of expired instruments
+    /// are reused) is moved to the new book; the old book keeps its state and
+    /// stays reachable through its index.
+    book_index add_book(uint32_t order_book_id, std::string symbol, uint64_t timestamp,
+                        uint16_t num_decimals_for_price = 0, size_t max_orders = 0);
+
+    /// \brief Removes the orders and levels of a book, returning their
+    /// storage to the engine, and gives back the orders add_book() reserved
+    /// for it. The book stays, empty.
+    void clear_book(book_index book);
+
+    /// \brief Returns the index of the book with the OrderBookID or npos.
+    book_index find_book(uint32_t order_book_id) const {
+        auto it = _books_by_id.find(order_book_id);
+        return it == _books_by_id.end() ? npos : it->second;
+    }
+
+    uint32_t order_book_id(book_index book) const {
+        return _order_book_ids[book];
+    }
+
+    size_t book_count() const {
+        return _order_book_ids.size();
+    }
+
+    //! Number of live orders across all books.
+    size_t order_count() const {
+        return _orders.size();
+    }
+
+    std::pmr::memory_resource* resource() const {
+        return _resource;
+    }
+
+private:
+    friend class order_book;
+
+    using order_set = order_table<order_record>;
+    using bid_ladder = price_ladder<std::greater<uint64_t>>;
+    using ask_ladder = price_ladder<std::less   <uint64_t>>;
+
+    std::pmr::memory_resource* _resource;
+    size_t _max_orders;
+    order_set _orders;
+    level_pool _levels;
+    //! Order timestamps by order table slot, empty unless a book keeps them.
+    std::pmr::vector<uint64_t> _order_timestamps;
+    std::pmr::unordered_map<uint32_t, book_index> _books_by_id;
+
+    // Columns of per-book state, indexed by book index.
+    std::pmr::vector<uint32_t> _order_book_ids;
+    std::pmr::vector<std::pmr::string> _symbols;
+    std::pmr::vector<std::pmr::string> _state_names;
+    std::pmr::vector<uint64_t> _timestamps;
+    std::pmr::vector<trading_state> _states;
+    std::pmr::vector<uint16_t> _num_decimals_for_price; // A value of 256 means that the instrument is traded in fractions (each fraction is 1/256). 
+    std::pmr::vector<size_t> _book_max_orders;
+    std::pmr::vector<size_t> _order_counts;
+    std::pmr::vector<uint8_t> _keep_order_timestamps;
+    std::pmr::vector<uint64_t> _bbo_versions;
+    //! Ladders never move, so depth views stay valid while books are added.
+    std::pmr::deque<bid_ladder> _bids;
+    std::pmr::deque<ask_ladder> _asks;
+};
+
+/// @}
+
+}
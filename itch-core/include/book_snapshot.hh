@@ -0,0 +1,98 @@
+#pragma once
+
+/// \file book_snapshot.hh
+///
+/// Publishing order books to reader threads.
+
+#include "order_book.hh"
+#include "seqlock.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace helix {
+
+/// \addtogroup order-book
+/// @{
+
+/// \brief Book snapshot is a copy of the top of an order book that can be
+/// read without touching the book.
+///
+/// Levels past the depth of the book are zero, like the levels returned by
+/// order_book::bid_level() and order_book::ask_level().
+struct book_snapshot {
+    //! Number of levels kept per side.
+    static constexpr size_t depth = 10;
+
+    struct level {
+        uint64_t price{ 0 };
+        uint64_t size{ 0 };
+        //! Number of orders queued at the level.
+        uint64_t count{ 0 };
+    };
+
+    uint64_t timestamp{ 0 };
+    //! BBO version of the book, see order_book::bbo_version().
+    uint64_t bbo_version{ 0 };
+    uint64_t order_count{ 0 };
+    //! Number of levels of each side of the book, which may exceed depth.
+    uint64_t bid_levels{ 0 };
+    uint64_t ask_levels{ 0 };
+    uint64_t decimals_for_price{ 0 };
+    level bids[depth];
+    level asks[depth];
+};
+
+/// \brief Book publisher hands snapshots of a book from the thread that
+/// builds it to any number of reader threads through a seqlock, so the
+/// writer never waits for readers.
+class book_publisher {
+public:
+    /// \brief Takes a snapshot of a book and publishes it. Only one thread
+    /// may publish.
+    void publish(const order_book& ob);
+
+    /// \brief Copies the latest snapshot to out and returns true, or returns
+    /// false if a publish was in progress.
+    bool try_read(book_snapshot& out) const {
+        return _snapshot.try_load(out);
+    }
+
+    /// \brief Returns the latest snapshot, retrying while a publish is in
+    /// progress.
+    book_snapshot read() const {
+        return _snapshot.load();
+    }
+
+    //! Number of snapshots published so far.
+    uint64_t version() const {
+        return _snapshot.version();
+    }
+
+private:
+    seqlock<book_snapshot> _snapshot;
+};
+
+/// \brief Top of book is the best bid and offer of an instrument and its
+/// last trade.
+///
+/// An empty bid side has a zero price and an empty ask side the largest
+/// price, like best_bid_offer.
+struct top_of_book {
+    uint64_t timestamp{ 0 };
+    uint64_t bid_price{ 0 };
+    uint64_t bid_size{ 0 };
+    uint64_t ask_price{ UINT64_MAX };
+    uint64_t ask_size{ 0 };
+    uint64_t last_price{ 0 };
+    uint64_t last_size{ 0 };
+};
+
+/// \brief Top of book publisher takes a single cache line, which readers
+/// can poll from any thread without a lock or a queue hop.
+using top_of_book_publisher = seqlock<top_of_book>;
+static_assert(sizeof(top_of_book_publisher) == 64, "top of book must fit a cache line");
+
+/// @}
+
+}
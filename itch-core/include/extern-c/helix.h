@@ -93,6 +93,43 @@ typedef struct helix_opaque_trade *helix_trade_t;
  */
 typedef struct helix_opaque_event *helix_event_t;
 
+/*!
+ * @typedef  helix_top_of_book_t
+ * @abstract Type of a top of book, which can be read from any thread.
+ */
+typedef struct helix_opaque_top_of_book *helix_top_of_book_t;
+
+/*!
+ * @struct   helix_quote_t
+ * @abstract Best bid and offer and last trade of an instrument.
+ *
+ * An empty bid side has a zero price and an empty ask side the largest
+ * price.
+ */
+typedef struct {
+    helix_timestamp_t timestamp;
+    helix_price_t bid_price;
+    uint64_t bid_size;
+    helix_price_t ask_price;
+    uint64_t ask_size;
+    helix_price_t last_price;
+    uint64_t last_size;
+} helix_quote_t;
+
+/*!
+ * @struct   helix_bbo_t
+ * @abstract Best bid and offer of an instrument.
+ *
+ * An empty bid side has a zero price and an empty ask side the largest
+ * price.
+ */
+typedef struct {
+    helix_price_t bid_price;
+    uint64_t bid_size;
+    helix_price_t ask_price;
+    uint64_t ask_size;
+} helix_bbo_t;
+
 /*!
  * @enum     helix_event_mask_t
  * @abstract Event mask.
@@ -108,6 +145,8 @@ typedef enum {
     HELIX_EVENT_OPENED = 1UL << 3,
     /*! Bist closed */
     HELIX_EVENT_CLOSED = 1UL << 4,
+    /*! Best bid or offer changed. */
+    HELIX_EVENT_BBO_CHANGED = 1UL << 5,
 } helix_event_mask_t;
 
 /*!
@@ -146,6 +185,14 @@ helix_order_book_t helix_event_order_book(helix_event_t);
  */
 helix_trade_t helix_event_trade(helix_event_t);
 
+/*!
+ * @abstract Reads the best bid and offer after an event.
+ *
+ * The best bid and offer is set if HELIX_EVENT_ORDER_BOOK_UPDATE bit is set in
+ * the event mask, and it moved if HELIX_EVENT_BBO_CHANGED bit is set as well.
+ */
+void helix_event_bbo(helix_event_t, helix_bbo_t *);
+
 /*!
  * @typedef  helix_event_callback_t
  * @abstract Type of an event callback.
@@ -293,6 +340,15 @@ void helix_session_destroy(helix_session_t session);
  */
 void helix_session_set_send_callback(helix_session_t, helix_send_callback_t);
 
+/*!
+ * @abstract Turns per-packet event coalescing on or off.
+ *
+ * When on, a single event is emitted per symbol and packet, carrying the union
+ * of the event masks and the last trade and best bid and offer. Call it before
+ * processing packets.
+ */
+void helix_session_set_coalescing(helix_session_t, bool coalesce);
+
 /*!
  * @abstract Returns session opaque context data.
  */
@@ -310,6 +366,13 @@ bool helix_session_is_rth_timestamp(helix_session_t, helix_timestamp_t);
  */
 size_t helix_session_process_packet(helix_session_t, const char* buf, size_t len);
 
+/*!
+ * @abstract Emit the events of the messages a session batched so far.
+ *
+ * This function is called by the packet I/O code when it has no more data at hand.
+ */
+void helix_session_flush(helix_session_t);
+
 /*!
  * @abstract Subscribe to listening to market data updates for a symbol.
  */
@@ -320,6 +383,22 @@ void helix_session_subscribe(helix_session_t, const char *symbol, size_t max_ord
  */
 void helix_session_unsubscribe(helix_subscription_t);
 
+/*!
+ * @abstract Returns the top of book of a symbol, subscribing to it if needed.
+ *
+ * The function returns NULL if the session cannot share its top of book. Call
+ * it before processing packets; the top of book stays valid as long as the
+ * session does.
+ */
+helix_top_of_book_t helix_session_top_of_book(helix_session_t, const char *symbol, size_t max_orders);
+
+/*!
+ * @abstract Reads a consistent copy of a top of book.
+ *
+ * The function may be called from any thread and never blocks the session.
+ */
+void helix_top_of_book_read(helix_top_of_book_t, helix_quote_t *);
+
 #ifdef __cplusplus
 }
 #endif
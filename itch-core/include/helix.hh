@@ -17,6 +17,7 @@
 #include <future>
 #include <type_traits>
 #include <string>
+#include <string_view>
 #include <memory>
 
 namespace helix {
@@ -27,6 +28,10 @@ namespace helix {
 
   }
 
+  class book_publisher;
+  template<typename T> class seqlock;
+  struct top_of_book;
+
   class unknown_message_type : public std::runtime_error {
   public:
     explicit unknown_message_type(std::string&& cause)
@@ -72,29 +77,79 @@ namespace helix {
     ev_sweep = 1UL << 2,
     ev_opened = 1UL << 3,
     ev_closed = 1UL << 4,
+    //! The best bid or offer changed, see event::get_bbo().
+    ev_bbo_changed = 1UL << 5,
   };
 
+  //! Instrument index of events that are not about an instrument.
+  constexpr uint32_t no_instrument = ~uint32_t{ 0 };
+
+  /// \brief Event is a plain value that owns no memory.
+  ///
+  /// The instrument is referred to by its index in the session that produced
+  /// the event and by an interned symbol, so events can be copied and queued
+  /// freely and building one never allocates.
   class event {
     uint64_t    _timestamp;
     trade _trade;
     event_mask  _mask;
-    std::string _symbol;
+    uint32_t    _instrument;
+    std::string_view _symbol;
+    best_bid_offer _bbo;
   public:
-    event(event_mask mask, std::string symbol, uint64_t timestamp, trade&&);
+    event(event_mask mask, std::string_view symbol, uint64_t timestamp, trade&&,
+          uint32_t instrument = no_instrument);
     event_mask get_mask() const;
-    std::string get_symbol() const;
+    //! Returns the symbol, which is valid for the lifetime of the process.
+    std::string_view get_symbol() const;
+    uint32_t get_instrument() const;
     uint64_t get_timestamp() const;
     trade* get_trade() const;
+    //! Returns the best bid and offer after the event, which is only set
+    //! on order book updates.
+    const best_bid_offer& get_bbo() const;
+    void set_bbo(const best_bid_offer& bbo);
   };
+  static_assert(std::is_trivially_copyable_v<event>, "event must stay a plain value");
+
+  /// \brief Returns a copy of symbol that is valid for the lifetime of the
+  /// process. Interning the same symbol twice returns the same copy.
+  std::string_view intern_symbol(std::string_view symbol);
 
-  std::shared_ptr<event> make_event(std::string symbol, uint64_t timestamp, trade&&, event_mask mask = 0);
+  /// \brief Copies an event into memory recycled from an event pool, which
+  /// is returned to the pool once the last reference is dropped.
+  std::shared_ptr<event> make_shared_event(const event& ev);
+
+  std::shared_ptr<event> make_event(std::string_view symbol, uint64_t timestamp, trade&&, event_mask mask = 0);
   std::shared_ptr<event> make_sys_event(uint64_t timestamp, event_mask mask = 0);
-  std::shared_ptr<event> make_ob_event(std::string symbol, uint64_t timestamp, event_mask mask = 0);
-  std::shared_ptr<event> make_trade_event(std::string symbol, uint64_t timestamp, trade&&, event_mask mask = 0);
+  std::shared_ptr<event> make_ob_event(std::string_view symbol, uint64_t timestamp, event_mask mask = 0);
+  std::shared_ptr<event> make_trade_event(std::string_view symbol, uint64_t timestamp, trade&&, event_mask mask = 0);
 
   //typedef void (*event_callback)(std::shared_ptr<event>);
   using event_callback = std::function<void(std::shared_ptr<event>)>;
 
+  //! Callback that is passed events by reference. The event is only valid
+  //! during the call; a callback that keeps it must copy it.
+  using event_ref_callback = std::function<void(const event&)>;
+
+  /// \brief Listener that passes events to a callback registered at run
+  /// time.
+  ///
+  /// Handlers take their listener as a template parameter and call its
+  /// on_event() without type erasure; this is the listener sessions use, and
+  /// the one indirect call it makes is the registered callback.
+  class callback_listener {
+    event_ref_callback _callback;
+  public:
+    void set_callback(event_ref_callback callback) {
+      _callback = std::move(callback);
+    }
+
+    void on_event(const event& ev) {
+      _callback(ev);
+    }
+  };
+
   using send_callback = std::function<void(char*, size_t)>;
 
   class session {
@@ -110,8 +165,7 @@ namespace helix {
 
     void register_event(std::string symbol, event_callback fun)
     {
-      subs.insert({symbol, {}});
-      subs.at(symbol).push_back(std::move(fun));
+      subs[intern_symbol(symbol)].push_back(std::move(fun));
       if (!is_registered)
       {
         this->register_callback(
@@ -140,7 +194,49 @@ namespace helix {
     
     virtual void register_callback(event_callback callback) = 0;
 
-    virtual void register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent) {}
+    /// \brief Returns true if callbacks may run on several threads at once,
+    /// as with a sharded handler. Otherwise they run on one thread at a
+    /// time, which single producer queues rely on.
+    virtual bool calls_back_concurrently() const { return false; }
+
+    /// \brief Registers a callback that is passed events by reference, which
+    /// saves copying every event into a shared_ptr.
+    virtual void register_event_callback(event_ref_callback callback) {
+      register_callback([callback = std::move(callback)](std::shared_ptr<event> ev) {
+        callback(*ev);
+      });
+    }
+
+    /// \brief Hands a private book of a symbol to an agent, which applies
+    /// the changes the session sends it on a thread of its own, subscribing
+    /// to the symbol if needed.
+    ///
+    /// Books shared with share_book() are the cheaper choice for readers;
+    /// an agent is for an owner that wants a book of its own, updated off
+    /// the feed thread. Sessions that cannot feed agents ignore it.
+    virtual void register_for_symbol(std::string /*symbol*/, std::unique_ptr<order_book_agent> /*ob_agent*/) {}
+
+    /// \brief Returns the publisher of a book the session builds once and
+    /// shares with any number of reader threads, subscribing to the symbol
+    /// if needed. Sessions that cannot share books return nullptr.
+    virtual const book_publisher* share_book(std::string /*symbol*/, size_t /*max_orders*/) { return nullptr; }
+
+    /// \brief Returns the publisher of the best bid and offer and last trade
+    /// of a symbol, which any thread can read, subscribing to the symbol if
+    /// needed. Sessions that cannot share it return nullptr.
+    virtual const seqlock<top_of_book>* share_top_of_book(std::string /*symbol*/, size_t /*max_orders*/) { return nullptr; }
+
+    /// \brief Turns per-packet event coalescing on or off.
+    ///
+    /// When on, all messages of a packet are applied to the books before any
+    /// event is emitted, and then a single event is emitted per instrument
+    /// the packet touched. Its mask is the union of the masks of the events
+    /// it stands for, and it carries the last timestamp, trade and BBO.
+    /// BinaryFILE has no packets, so there a batch of up to
+    /// binaryfile_session::flush_interval messages, or the messages since
+    /// the last flush(), stands for a packet. Sessions that cannot coalesce
+    /// ignore it.
+    virtual void set_coalescing(bool /*coalesce*/) {}
 
     virtual std::string subscribe(const std::string& symbol, size_t max_orders) = 0;
 
@@ -150,8 +246,16 @@ namespace helix {
 
     virtual size_t process_packet(const net::packet_view& packet) = 0;
 
+    /// \brief Ends the batch of messages processed so far, emitting the
+    /// events it held back. Sessions that batch messages of their own
+    /// accord, like BinaryFILE, are flushed by the caller whenever it has no
+    /// more data at hand, so that the last batch is not held back.
+    virtual void flush() {}
+
   private:
-    std::unordered_map<std::string, std::vector<event_callback>> subs;
+    //! Keyed by interned symbols, so that events are looked up by their
+    //! string_view without building a string.
+    std::unordered_map<std::string_view, std::vector<event_callback>> subs;
     bool is_registered{ false };
     void* _data;
   };
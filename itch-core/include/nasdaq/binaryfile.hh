@@ -23,20 +23,44 @@ namespace nasdaq {
 template<typename Handler>
 class binaryfile_session final : public session {
     Handler _handler;
+    //! Whether the handler coalesces events, see set_coalescing().
+    bool _coalescing{ false };
+    //! Messages processed since the handler was last flushed.
+    size_t _unflushed{ 0 };
 public:
+    //! BinaryFILE has no packets, so when coalescing the handler is flushed
+    //! every this many messages, at the end of the session and when flush()
+    //! is called. Otherwise it is flushed after every message.
+    static constexpr size_t flush_interval = 64;
+
     explicit binaryfile_session(void* data);
 
+    //! Returns the handler, and through it the listener it passes events to.
+    Handler& handler() { return _handler; }
+
     bool is_rth_timestamp(uint64_t timestamp) override;
 
     std::string subscribe(const std::string& symbol, size_t max_orders) override;
 
     void register_callback(event_callback callback) override;
 
+    void register_event_callback(event_ref_callback callback) override;
+
+    bool calls_back_concurrently() const override { return _handler.calls_back_concurrently(); }
+
+    void set_coalescing(bool coalesce) override;
+
     void set_send_callback(send_callback send_cb) override;
 
     size_t process_packet(const net::packet_view& packet) override;
 
+    void flush() override;
+
     void register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent) override;
+
+    const book_publisher* share_book(std::string symbol, size_t max_orders) override;
+
+    const seqlock<top_of_book>* share_top_of_book(std::string symbol, size_t max_orders) override;
 };
 
 template<typename Handler>
@@ -63,12 +87,37 @@ void binaryfile_session<Handler>::register_callback(event_callback callback)
     _handler.register_callback(callback);
 }
 
+template<typename Handler>
+void binaryfile_session<Handler>::register_event_callback(event_ref_callback callback)
+{
+    _handler.register_event_callback(std::move(callback));
+}
+
+template<typename Handler>
+void binaryfile_session<Handler>::set_coalescing(bool coalesce)
+{
+    _handler.set_coalescing(coalesce);
+    _coalescing = coalesce;
+}
+
 template<typename Handler>
 void binaryfile_session<Handler>::register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent) 
 {
   _handler.register_for_symbol(symbol, std::move(ob_agent));
 }
 
+template<typename Handler>
+const book_publisher* binaryfile_session<Handler>::share_book(std::string symbol, size_t max_orders)
+{
+  return &_handler.share_book(std::move(symbol), max_orders);
+}
+
+template<typename Handler>
+const seqlock<top_of_book>* binaryfile_session<Handler>::share_top_of_book(std::string symbol, size_t max_orders)
+{
+  return &_handler.share_top_of_book(std::move(symbol), max_orders);
+}
+
 template<typename Handler>
 void binaryfile_session<Handler>::set_send_callback(send_callback send_cb)
 {
@@ -80,6 +129,7 @@ size_t binaryfile_session<Handler>::process_packet(const net::packet_view& packe
   uint16_t payload_len = swap_bytes(*packet.cast<uint16_t>());
   if (!payload_len) {
     // End of session.
+    flush();
     return 0;
   }
   size_t offset = sizeof(uint16_t);
@@ -91,9 +141,19 @@ size_t binaryfile_session<Handler>::process_packet(const net::packet_view& packe
     payload_len -= static_cast<uint16_t>(nr);
     offset += nr;
   }
+  if (!_coalescing || ++_unflushed == flush_interval) {
+    flush();
+  }
   return offset;
 }
 
+template<typename Handler>
+void binaryfile_session<Handler>::flush()
+{
+  _unflushed = 0;
+  _handler.flush_events();
+}
+
 }
 
 }
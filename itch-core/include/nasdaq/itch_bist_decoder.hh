@@ -0,0 +1,283 @@
+#pragma once
+
+/// \file itch_bist_decoder.hh
+///
+/// Decoding of ITCH BIST wire messages into aligned host order structs.
+
+#include "nasdaq/itch_bist_messages.h"
+#include "net.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+namespace helix {
+
+namespace nasdaq {
+
+/// \brief Reverses the bytes of an unsigned integer, like C++23 std::byteswap.
+inline uint16_t byteswap(uint16_t v) {
+#ifdef _MSC_VER
+  return _byteswap_ushort(v);
+#else
+  return __builtin_bswap16(v);
+#endif
+}
+
+inline uint32_t byteswap(uint32_t v) {
+#ifdef _MSC_VER
+  return _byteswap_ulong(v);
+#else
+  return __builtin_bswap32(v);
+#endif
+}
+
+inline uint64_t byteswap(uint64_t v) {
+#ifdef _MSC_VER
+  return _byteswap_uint64(v);
+#else
+  return __builtin_bswap64(v);
+#endif
+}
+
+template <size_t size> struct itch_bist_uint;
+template <> struct itch_bist_uint<2> { using type = uint16_t; };
+template <> struct itch_bist_uint<4> { using type = uint32_t; };
+template <> struct itch_bist_uint<8> { using type = uint64_t; };
+
+/// \brief Reads a big-endian field from unaligned memory.
+///
+/// The copies compile to a single load, and the swap to a bswap or a movbe,
+/// so a field costs what the swap_bytes() of an in place read did without
+/// the unaligned access through a packed struct.
+template <typename T>
+inline T load_be(const char* p) {
+  static_assert(std::is_trivially_copyable_v<T>, "only plain fields can be decoded");
+  T v;
+  if constexpr (sizeof(T) == 1) {
+    std::memcpy(&v, p, 1);
+  } else {
+    typename itch_bist_uint<sizeof(T)>::type u;
+    std::memcpy(&u, p, sizeof(u));
+    u = byteswap(u);
+    std::memcpy(&v, &u, sizeof(v));
+  }
+  return v;
+}
+
+/*!
+* Host order form of an ITCH BIST wire message.
+*
+* A decoded message has the fields of its wire struct under the same names,
+* naturally aligned and in host byte order; text fields are copied as they
+* are. Reserved fields and the message type are left out.
+*/
+template <class msg_t>
+struct itch_bist_decoded;
+
+// The field lists below generate the decoded structs and their decoders.
+// F(type, name) is a big-endian scalar and A(name) a text field.
+
+#define ITCH_BIST_SECONDS_FIELDS(F, A) \
+  F(uint32_t, UtcSeconds)
+
+#define ITCH_BIST_ORDER_BOOK_DIRECTORY_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint32_t, OrderBookID) \
+  A(Symbol) \
+  A(LongName) \
+  A(ISINCode) \
+  F(financial_product_e, FinancialProduct) \
+  A(TradingCurrency) \
+  F(uint16_t, NumberOfDecimalsInPrice) \
+  F(uint16_t, NumberOfDecimalsInNominalValue) \
+  F(uint32_t, OddLotSize) \
+  F(uint32_t, RoundLotSize) \
+  F(uint32_t, BlockLotSize) \
+  F(uint64_t, NominalValue) \
+  F(uint8_t, NumberOfLegs) \
+  F(uint32_t, UnderlyingOrderBookID) \
+  F(uint32_t, StrikePrice) \
+  F(uint32_t, ExpirationDate) \
+  F(uint16_t, DecimalsInStrikePrice) \
+  F(put_or_call_e, PutOrCall)
+
+#define ITCH_BIST_COMBINATION_ORDER_BOOK_LEG_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint32_t, OrderBookID) \
+  F(uint32_t, LegOrderBookID) \
+  F(leg_side_e, legSide) \
+  F(uint32_t, LegRatio)
+
+#define ITCH_BIST_TICK_SIZE_TABLE_ENTRY_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint32_t, OrderBookID) \
+  F(uint64_t, TickSize) \
+  F(uint32_t, PriceFrom) \
+  F(uint32_t, PriceTo)
+
+#define ITCH_BIST_SYSTEM_EVENT_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(system_event_code_e, EventCode)
+
+#define ITCH_BIST_ORDER_BOOK_STATE_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint32_t, OrderBookID) \
+  A(StateName)
+
+#define ITCH_BIST_ADD_ORDER_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint64_t, OrderID) \
+  F(uint32_t, OrderBookID) \
+  F(buy_sell_e, Side) \
+  F(uint32_t, OrderBookPosition) \
+  F(uint64_t, Quantity) \
+  F(uint32_t, Price) \
+  F(uint16_t, OrderAttributes) \
+  F(uint8_t, LotType)
+
+#define ITCH_BIST_ADD_ORDER_MPID_FIELDS(F, A) \
+  ITCH_BIST_ADD_ORDER_FIELDS(F, A) \
+  A(ParticipantID)
+
+#define ITCH_BIST_ORDER_EXECUTED_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint64_t, OrderID) \
+  F(uint32_t, OrderBookID) \
+  F(buy_sell_e, Side) \
+  F(uint64_t, ExecutedQuantity) \
+  F(uint64_t, MatchID) \
+  F(uint32_t, ComboGroupID)
+
+#define ITCH_BIST_ORDER_EXECUTED_WITH_PRICE_FIELDS(F, A) \
+  ITCH_BIST_ORDER_EXECUTED_FIELDS(F, A) \
+  F(uint32_t, TradePrice) \
+  F(char, OccurredAtCross) \
+  F(char, Printable)
+
+#define ITCH_BIST_ORDER_REPLACE_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint64_t, OrderID) \
+  F(uint32_t, OrderBookID) \
+  F(buy_sell_e, Side) \
+  F(uint32_t, NewOrderBookPosition) \
+  F(uint64_t, Quantity) \
+  F(uint32_t, Price) \
+  F(uint16_t, OrderAttributes)
+
+#define ITCH_BIST_ORDER_DELETE_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint64_t, OrderID) \
+  F(uint32_t, OrderBookID) \
+  F(buy_sell_e, Side)
+
+#define ITCH_BIST_TRADE_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint64_t, MatchID) \
+  F(uint32_t, ComboGroupID) \
+  F(buy_sell_e, Side) \
+  F(uint64_t, Quantity) \
+  F(uint32_t, OrderBookID) \
+  F(uint32_t, TradePrice) \
+  F(char, Printable) \
+  F(char, OccurredAtCross)
+
+#define ITCH_BIST_EQUILIBRIUM_PRICE_UPDATE_FIELDS(F, A) \
+  F(uint32_t, TimestampNanoseconds) \
+  F(uint32_t, OrderBookID) \
+  F(uint64_t, AvailableBidQuantityAtPrice) \
+  F(uint64_t, AvailableAskQuantityAtPrice) \
+  F(uint32_t, EquilibriumPrice) \
+  F(uint32_t, BestBidPrice) \
+  F(uint32_t, BestAskPrice) \
+  F(uint64_t, BestBidQuantity) \
+  F(uint64_t, BestAskQuantity)
+
+#define ITCH_BIST_DECLARE_FIELD(type, name) type name;
+#define ITCH_BIST_DECLARE_TEXT(name) char name[sizeof(wire_type::name)];
+#define ITCH_BIST_DECODE_FIELD(type, name) m.name = load_be<type>(p + offsetof(wire_type, name));
+#define ITCH_BIST_DECODE_TEXT(name) std::memcpy(m.name, p + offsetof(wire_type, name), sizeof(m.name));
+
+#define ITCH_BIST_DECODED(msg_t, FIELDS) \
+  template <> struct itch_bist_decoded<msg_t> { \
+    using wire_type = msg_t; \
+    FIELDS(ITCH_BIST_DECLARE_FIELD, ITCH_BIST_DECLARE_TEXT) \
+    /*! Decodes a whole message; p points at its MessageType. */ \
+    static itch_bist_decoded decode(const char* p) { \
+      itch_bist_decoded m; \
+      FIELDS(ITCH_BIST_DECODE_FIELD, ITCH_BIST_DECODE_TEXT) \
+      return m; \
+    } \
+  }; \
+  static_assert(std::is_trivially_copyable_v<itch_bist_decoded<msg_t>>, \
+                #msg_t " must decode to a plain struct")
+
+ITCH_BIST_DECODED(itch_bist_seconds, ITCH_BIST_SECONDS_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_book_directory, ITCH_BIST_ORDER_BOOK_DIRECTORY_FIELDS);
+ITCH_BIST_DECODED(itch_bist_combination_order_book_leg, ITCH_BIST_COMBINATION_ORDER_BOOK_LEG_FIELDS);
+ITCH_BIST_DECODED(itch_bist_tick_size_table_entry, ITCH_BIST_TICK_SIZE_TABLE_ENTRY_FIELDS);
+ITCH_BIST_DECODED(itch_bist_system_event, ITCH_BIST_SYSTEM_EVENT_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_book_state, ITCH_BIST_ORDER_BOOK_STATE_FIELDS);
+ITCH_BIST_DECODED(itch_bist_add_order, ITCH_BIST_ADD_ORDER_FIELDS);
+ITCH_BIST_DECODED(itch_bist_add_order_mpid, ITCH_BIST_ADD_ORDER_MPID_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_executed, ITCH_BIST_ORDER_EXECUTED_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_executed_with_price, ITCH_BIST_ORDER_EXECUTED_WITH_PRICE_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_replace, ITCH_BIST_ORDER_REPLACE_FIELDS);
+ITCH_BIST_DECODED(itch_bist_order_delete, ITCH_BIST_ORDER_DELETE_FIELDS);
+ITCH_BIST_DECODED(itch_bist_trade, ITCH_BIST_TRADE_FIELDS);
+ITCH_BIST_DECODED(itch_bist_equilibrium_price_update, ITCH_BIST_EQUILIBRIUM_PRICE_UPDATE_FIELDS);
+
+#undef ITCH_BIST_DECODED
+#undef ITCH_BIST_DECODE_TEXT
+#undef ITCH_BIST_DECODE_FIELD
+#undef ITCH_BIST_DECLARE_TEXT
+#undef ITCH_BIST_DECLARE_FIELD
+
+/*!
+* A decoded message of any type, tagged by its MessageType.
+*/
+struct itch_bist_decoded_message {
+  char MessageType;
+  union {
+    itch_bist_decoded<itch_bist_seconds> seconds;
+    itch_bist_decoded<itch_bist_order_book_directory> order_book_directory;
+    itch_bist_decoded<itch_bist_combination_order_book_leg> combination_order_book_leg;
+    itch_bist_decoded<itch_bist_tick_size_table_entry> tick_size_table_entry;
+    itch_bist_decoded<itch_bist_system_event> system_event;
+    itch_bist_decoded<itch_bist_order_book_state> order_book_state;
+    itch_bist_decoded<itch_bist_add_order> add_order;
+    itch_bist_decoded<itch_bist_add_order_mpid> add_order_mpid;
+    itch_bist_decoded<itch_bist_order_executed> order_executed;
+    itch_bist_decoded<itch_bist_order_executed_with_price> order_executed_with_price;
+    itch_bist_decoded<itch_bist_order_replace> order_replace;
+    itch_bist_decoded<itch_bist_order_delete> order_delete;
+    itch_bist_decoded<itch_bist_trade> trade;
+    itch_bist_decoded<itch_bist_equilibrium_price_update> equilibrium_price_update;
+  };
+};
+
+/// \brief Decodes the message at the start of buf and returns its size on
+/// the wire.
+///
+/// Throws unknown_message_type for a message type that is not in the
+/// specification and truncated_packet_error if the message does not fit in
+/// len bytes.
+size_t itch_bist_decode(const char* buf, size_t len, itch_bist_decoded_message& out);
+
+/// \brief Decodes every message of a BinaryFILE or MoldUDP payload and
+/// appends them to out, in order. Returns the number of messages decoded.
+///
+/// Decoding is independent of subscriptions and order books, so a payload
+/// can be decoded ahead of or apart from applying it with
+/// itch_bist_handler::process_messages().
+size_t itch_bist_decode_payload(const net::packet_view& payload, std::vector<itch_bist_decoded_message>& out);
+
+}
+
+}
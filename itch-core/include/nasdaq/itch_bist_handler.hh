@@ -1,20 +1,38 @@
 #pragma once
 
-#include "nasdaq/itch_bist_messages.h"
+#include "nasdaq/itch_bist_decoder.hh"
+#include "book_snapshot.hh"
 #include "order_book_agent.h"
 #include "helix.hh"
 #include "net.hh"
+#include "order_book.hh"
 
+#include <stdexcept>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <set>
 #include <chrono>
+#include <optional>
 
 namespace helix {
 
 namespace nasdaq {
 
+//! Whether a listener takes callbacks registered at run time.
+template<typename Listener, typename = void>
+struct accepts_event_callback : std::false_type {};
+
+template<typename Listener>
+struct accepts_event_callback<Listener, std::void_t<decltype(
+    std::declval<Listener&>().set_callback(std::declval<event_ref_callback>()))>>
+  : std::true_type {};
+
 // NASDAQ TotalView-ITCH BIST v.4.5
 //
 // This is a feed handler for Total-View ITCH. The handler assumes that
@@ -27,50 +45,712 @@ namespace nasdaq {
 //   Version 5.0
 //   03/06/2015
 //
+// Events are passed to a Listener, which has a member
+//
+//   void on_event(const event& ev);
+//
+// The handler calls it directly, so a listener known at compile time is
+// inlined into the message processing. The default callback_listener
+// forwards events to the callbacks registered with register_callback() or
+// register_event_callback(); other listeners need to accept callbacks, see
+// accepts_event_callback, for those to work.
+//
+template<typename Listener = callback_listener>
 class itch_bist_handler {
 private:
-    //! Callback function for processing events.
-    event_callback _process_event;
-    //! A map of order books by order book ID.
-    std::unordered_map<std::string, std::vector<std::unique_ptr<order_book_agent>>> order_book_sym_map;
-    std::unordered_map<uint64_t, std::string> order_book_id_sym_map;
+    //! A subscribed instrument and the order books following it.
+    struct instrument {
+        //! Interned padded symbol, see intern_symbol().
+        std::string_view symbol;
+        //! Index of the instrument, carried by its events.
+        uint32_t index;
+        std::vector<std::unique_ptr<order_book_agent>> books;
+        //! Copy of the books kept on the feed thread, created when the
+        //! instrument is listed. Executions are attributed and the BBO is
+        //! read from it, so the books are only ever sent commands and the
+        //! feed thread never waits for a book thread.
+        std::optional<order_book> shadow;
+        //! Publishes the shadow to reader threads, see share_book().
+        std::unique_ptr<book_publisher> publisher;
+        //! Top of book as last published, see share_top_of_book().
+        top_of_book top;
+        std::unique_ptr<top_of_book_publisher> top_publisher;
+        //! The OrderBookID the instrument was last listed with, if any.
+        uint32_t order_book_id{ no_order_book_id };
+        //! Event held back until the end of the packet when coalescing.
+        std::optional<event> pending;
+        //! BBO version of the first book when the last event was emitted.
+        uint64_t bbo_version{ 0 };
+    };
+    static constexpr uint32_t no_order_book_id = ~uint32_t{ 0 };
+    //! OrderBookIDs below this are dispatched through the flat table.
+    static constexpr uint32_t max_flat_order_book_id = uint32_t{ 1 } << 20;
+
+    //! Listener that is passed the events.
+    Listener _listener;
+    //! Storage of the shadow books of the instruments.
+    book_engine _shadow_books;
+    //! Subscribed instruments, in the order they were registered.
+    std::vector<instrument> _instruments;
+    //! Instrument index by padded symbol.
+    std::unordered_map<std::string, uint32_t> _instrument_by_symbol;
+    //! Instrument index plus one by OrderBookID, zero for the OrderBookIDs
+    //! of instruments nobody subscribed to. Filled by directory messages.
+    std::vector<uint32_t> _instrument_by_id;
+    //! Instrument index plus one for OrderBookIDs too large for the table.
+    std::unordered_map<uint32_t, uint32_t> _far_instrument_by_id;
     //! A set of symbols that we are interested in.
     std::set<std::string> _symbols;
     //! A map of pre-allocation size by symbol.
     std::unordered_map<std::string, size_t> _symbol_max_orders;
+    //! Whether events are coalesced per packet, see session::set_coalescing().
+    bool _coalescing{ false };
+    //! Instruments with a pending event, in the order they were touched.
+    std::vector<uint32_t> _touched;
     //! Working utc time seconds. nanoseconds will be padded on all other messages
     std::chrono::seconds time_secs {0};
+    //! Whether a jump of the working time is printed, see set_reports_time().
+    bool _reports_time{ true };
 public:
     itch_bist_handler() = default;
-    ~itch_bist_handler();
+    explicit itch_bist_handler(Listener listener)
+        : _listener{ std::move(listener) }
+    { }
+    Listener& listener() { return _listener; }
     bool is_rth_timestamp(uint64_t timestamp) const;
     std::string subscribe(std::string sym, size_t max_orders);
     void register_callback(event_callback callback);
+    //! Events are emitted on the thread that processes packets.
+    bool calls_back_concurrently() const { return false; }
+    void register_event_callback(event_ref_callback callback);
+    void set_coalescing(bool coalesce);
+    //! Prints the working utc time when seconds messages jump ahead; on by
+    //! default. Handlers that are passed the same seconds messages as
+    //! another, like the shards of itch_bist_sharded_handler, turn it off.
+    void set_reports_time(bool report) { _reports_time = report; }
+    //! Emits the events held back while coalescing.
+    void flush_events();
     size_t process_packet(const net::packet_view& packet);
+    /// \brief Applies messages decoded with itch_bist_decode_payload(), like
+    /// process_packet() does for the messages of a payload.
+    void process_messages(const itch_bist_decoded_message* msgs, size_t count);
     void register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent);
+    /// \brief Returns the publisher of the book of a symbol and subscribes
+    /// to the symbol if needed.
+    ///
+    /// The book is the one the handler builds on the feed thread anyway; it
+    /// is published after every change, and any number of threads can read
+    /// it without slowing the feed down. Call before processing starts.
+    const book_publisher& share_book(std::string symbol, size_t max_orders);
+    /// \brief Returns the publisher of the top of book of a symbol, updated
+    /// on every book update and trade, and subscribes to the symbol if
+    /// needed. Call before processing starts.
+    const top_of_book_publisher& share_top_of_book(std::string symbol, size_t max_orders);
 private:
+    //! Processes a message and returns its size, see itch_bist_msg_traits.
     template<typename T>
     size_t process_msg(const net::packet_view& packet);
-    void process_msg(const itch_bist_seconds* m);
-    void process_msg(const itch_bist_order_book_directory* m);
-    void process_msg(const itch_bist_combination_order_book_leg* m);
-    void process_msg(const itch_bist_tick_size_table_entry* m);
-    void process_msg(const itch_bist_system_event* m);
-    void process_msg(const itch_bist_order_book_state* m);
-    void process_msg(const itch_bist_add_order* m);
-    void process_msg(const itch_bist_add_order_mpid* m);
-    void process_msg(const itch_bist_order_executed* m);
-    void process_msg(const itch_bist_order_executed_with_price* m);
-    void process_msg(const itch_bist_order_replace* m);
-    void process_msg(const itch_bist_order_delete* m);
-    void process_msg(const itch_bist_trade* m);
-    void process_msg(const itch_bist_equilibrium_price_update* m);
+    //! Processes a decoded message, see process_messages().
+    template<typename T>
+    void process_decoded(const itch_bist_decoded<T>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_seconds>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_order_book_directory>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_combination_order_book_leg>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_tick_size_table_entry>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_system_event>& m);
+    void process_msg(const itch_bist_decoded<itch_bist_order_book_state>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_add_order>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_add_order_mpid>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_order_executed>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_order_executed_with_price>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_order_replace>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_order_delete>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_trade>& m, instrument& inst);
+    void process_msg(const itch_bist_decoded<itch_bist_equilibrium_price_update>& m);
+    //! Returns the subscribed instrument listed with an OrderBookID or nullptr.
+    instrument* find_instrument(uint32_t order_book_id) {
+        if (order_book_id < _instrument_by_id.size()) {
+            auto slot = _instrument_by_id[order_book_id];
+            return slot ? &_instruments[slot - 1] : nullptr;
+        }
+        if (order_book_id >= max_flat_order_book_id && !_far_instrument_by_id.empty()) {
+            if (auto it = _far_instrument_by_id.find(order_book_id); it != _far_instrument_by_id.end()) {
+                return &_instruments[it->second - 1];
+            }
+        }
+        return nullptr;
+    }
+    //! Returns the instrument of a symbol, adding it if it is new.
+    instrument& add_instrument(std::string symbol, size_t max_orders);
+    //! Points an OrderBookID at an instrument, or at none when slot is zero.
+    void map_order_book_id(uint32_t order_book_id, uint32_t slot);
+    //! Emits an event of an instrument, or merges it into the pending one.
+    //! Order book updates carry the BBO and flag a change of it.
+    void emit(instrument& inst, event ev);
+    //! Book update event of an instrument.
+    static event book_event(const instrument& inst, uint64_t timestamp, event_mask mask = 0);
+    //! Trade event of an instrument.
+    static event trade_event(const instrument& inst, uint64_t timestamp, trade&& t, event_mask mask = 0);
     //! Generate a sweep event if execution cleared a price level.
     event_mask sweep_event(const execution&) const;
     //! Generate timestamp with nanoseconds
-    uint64_t itch_bist_timestamp(uint32_t raw_timestamp);
+    uint64_t itch_bist_timestamp(uint32_t timestamp_nanoseconds);
 };
 
+inline side_type itch_bist_side(char c)
+{
+  switch (c) {
+  case 'B': return side_type::buy;
+  case 'S': return side_type::sell;
+  default:  throw std::invalid_argument(std::string("invalid argument: ") + std::to_string(c));
+  }
+}
+
+inline trade_sign itch_bist_trade_sign(side_type s)
+{
+  switch (s) {
+  case side_type::buy:  return trade_sign::seller_initiated;
+  case side_type::sell: return trade_sign::buyer_initiated;
+  default:              throw std::invalid_argument(std::string("invalid argument"));
+  }
+}
+
+template<typename Listener>
+uint64_t itch_bist_handler<Listener>::itch_bist_timestamp(uint32_t timestamp_nanoseconds)
+{
+  using namespace std::chrono;
+  auto timestamp = duration_cast<nanoseconds>(time_secs).count();
+  timestamp += timestamp_nanoseconds;
+  return timestamp;
+}
+
+template<typename Listener>
+bool itch_bist_handler<Listener>::is_rth_timestamp(uint64_t timestamp) const
+{
+  using namespace std::chrono_literals;
+  using namespace std::chrono;
+
+  constexpr uint64_t rth_start = duration_cast<nanoseconds>(9h + 30min).count();
+  constexpr uint64_t rth_end = duration_cast<nanoseconds>(16h).count();
+  // TODO(oguzhank): burada gun basindan itibaren bakiyor ama bizim timestamp utc nanosecond!
+  // bunu cozmek gerekiyor
+  //return timestamp >= rth_start && timestamp < rth_end;
+  return true;
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::register_for_symbol(
+  std::string symbol, 
+  std::unique_ptr<order_book_agent> ob_agent)
+{
+  auto max_orders = ob_agent->max_orders();
+  add_instrument(std::move(symbol), max_orders).books.push_back(std::move(ob_agent));
+}
+
+template<typename Listener>
+const book_publisher& itch_bist_handler<Listener>::share_book(std::string symbol, size_t max_orders)
+{
+  auto& inst = add_instrument(std::move(symbol), max_orders);
+  if (!inst.publisher) {
+    inst.publisher = std::make_unique<book_publisher>();
+    if (inst.shadow) {
+      inst.publisher->publish(*inst.shadow);
+    }
+  }
+  return *inst.publisher;
+}
+
+template<typename Listener>
+const top_of_book_publisher& itch_bist_handler<Listener>::share_top_of_book(std::string symbol, size_t max_orders)
+{
+  auto& inst = add_instrument(std::move(symbol), max_orders);
+  if (!inst.top_publisher) {
+    inst.top_publisher = std::make_unique<top_of_book_publisher>();
+    inst.top_publisher->store(inst.top);
+  }
+  return *inst.top_publisher;
+}
+
+template<typename Listener>
+typename itch_bist_handler<Listener>::instrument&
+itch_bist_handler<Listener>::add_instrument(std::string symbol, size_t max_orders)
+{
+  auto padding = ITCH_SYMBOL_LEN - symbol.size();
+  if (padding > 0) {
+    symbol.insert(symbol.size(), padding, ' ');
+  }
+  _symbols.insert(symbol);
+  _symbol_max_orders.emplace(symbol, max_orders);
+
+  auto [it, inserted] = _instrument_by_symbol.emplace(symbol, static_cast<uint32_t>(_instruments.size()));
+  if (inserted) {
+    instrument inst{};
+    inst.symbol = intern_symbol(symbol);
+    inst.index = it->second;
+    _instruments.push_back(std::move(inst));
+  }
+  return _instruments[it->second];
+}
+
+template<typename Listener>
+std::string itch_bist_handler<Listener>::subscribe(std::string sym, size_t max_orders) {
+  auto padding = ITCH_SYMBOL_LEN - sym.size();
+  if (padding > 0) {
+    sym.insert(sym.size(), padding, ' ');
+  }
+  _symbols.insert(sym);
+  _symbol_max_orders.emplace(sym, max_orders);
+  _instruments.reserve(_symbols.size());
+  _instrument_by_symbol.reserve(_symbols.size());
+  return sym;
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::register_callback(event_callback callback) {
+  register_event_callback([callback = std::move(callback)](const event& ev) {
+    callback(make_shared_event(ev));
+  });
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::register_event_callback(event_ref_callback callback) {
+  if constexpr (accepts_event_callback<Listener>::value) {
+    _listener.set_callback(std::move(callback));
+  } else {
+    throw std::logic_error("the listener of this handler does not take callbacks");
+  }
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::set_coalescing(bool coalesce) {
+  flush_events();
+  _coalescing = coalesce;
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::emit(instrument& inst, event ev)
+{
+  if (ev.get_mask() & ev_order_book_update && inst.shadow) {
+    // All books of an instrument follow the same feed, so the shadow
+    // speaks for them.
+    auto bbo = inst.shadow->bbo();
+    if (bbo.version != inst.bbo_version) {
+      inst.bbo_version = bbo.version;
+      ev = event{ ev.get_mask() | ev_bbo_changed, ev.get_symbol(), ev.get_timestamp(), std::move(*ev.get_trade()), ev.get_instrument() };
+    }
+    ev.set_bbo(bbo);
+    if (inst.publisher) {
+      inst.publisher->publish(*inst.shadow);
+    }
+    inst.top.bid_price = bbo.bid_price;
+    inst.top.bid_size = bbo.bid_size;
+    inst.top.ask_price = bbo.ask_price;
+    inst.top.ask_size = bbo.ask_size;
+  }
+  if (ev.get_mask() & ev_trade) {
+    inst.top.last_price = ev.get_trade()->price;
+    inst.top.last_size = ev.get_trade()->size;
+  }
+  if (inst.top_publisher) {
+    inst.top.timestamp = ev.get_timestamp();
+    inst.top_publisher->store(inst.top);
+  }
+  if (!_coalescing) {
+    _listener.on_event(ev);
+    return;
+  }
+  if (!inst.pending) {
+    inst.pending = ev;
+    _touched.push_back(inst.index);
+    return;
+  }
+  auto& pending = *inst.pending;
+  auto t = ev.get_mask() & ev_trade ? *ev.get_trade() : *pending.get_trade();
+  auto bbo = ev.get_mask() & ev_order_book_update ? ev.get_bbo() : pending.get_bbo();
+  pending = event{ pending.get_mask() | ev.get_mask(), inst.symbol, ev.get_timestamp(), std::move(t), inst.index };
+  pending.set_bbo(bbo);
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::flush_events()
+{
+  for (auto index : _touched) {
+    auto& inst = _instruments[index];
+    auto ev = *inst.pending;
+    inst.pending.reset();
+    _listener.on_event(ev);
+  }
+  _touched.clear();
+}
+
+template<typename Listener>
+event itch_bist_handler<Listener>::book_event(const instrument& inst, uint64_t timestamp, event_mask mask)
+{
+  return event{ mask | ev_order_book_update, inst.symbol, timestamp, trade{}, inst.index };
+}
+
+template<typename Listener>
+event itch_bist_handler<Listener>::trade_event(const instrument& inst, uint64_t timestamp, trade&& t, event_mask mask)
+{
+  return event{ mask | ev_trade, inst.symbol, timestamp, std::move(t), inst.index };
+}
+
+template<typename Listener>
+size_t itch_bist_handler<Listener>::process_packet(const net::packet_view& packet)
+{
+  auto* msg = packet.cast<itch_bist_message>();
+  switch (msg->MessageType) {
+  case 'T': return process_msg<itch_bist_seconds>(packet);
+  case 'R': return process_msg<itch_bist_order_book_directory>(packet);
+  case 'M': return process_msg<itch_bist_combination_order_book_leg>(packet);
+  case 'L': return process_msg<itch_bist_tick_size_table_entry>(packet);
+  case 'S': return process_msg<itch_bist_system_event>(packet);
+  case 'O': return process_msg<itch_bist_order_book_state>(packet);
+  case 'A': return process_msg<itch_bist_add_order>(packet);
+  case 'F': return process_msg<itch_bist_add_order_mpid>(packet);
+  case 'E': return process_msg<itch_bist_order_executed>(packet);
+  case 'C': return process_msg<itch_bist_order_executed_with_price>(packet);
+  case 'U': return process_msg<itch_bist_order_replace>(packet);
+  case 'D': return process_msg<itch_bist_order_delete>(packet);
+  case 'P': return process_msg<itch_bist_trade>(packet);
+  case 'Z': return process_msg<itch_bist_equilibrium_price_update>(packet);
+  default: throw unknown_message_type("unknown type: " + std::string(1, msg->MessageType));
+  }
+}
+
+template<typename Listener>
+template<typename T>
+size_t itch_bist_handler<Listener>::process_msg(const net::packet_view& packet)
+{
+  using traits = itch_bist_msg_traits<T>;
+  if constexpr (traits::filter_by_order_book) {
+    // Most messages are for order books nobody subscribed to, so the
+    // OrderBookID is read in place and decides before anything is decoded.
+    auto order_book_id = load_be<uint32_t>(packet.buf() + traits::order_book_id_offset);
+    if (auto* inst = find_instrument(order_book_id)) {
+      process_msg(itch_bist_decoded<T>::decode(packet.buf()), *inst);
+    }
+  } else if constexpr (traits::should_process) {
+    process_msg(itch_bist_decoded<T>::decode(packet.buf()));
+  }
+  return traits::packet_size;
+}
+
+template<typename Listener>
+template<typename T>
+void itch_bist_handler<Listener>::process_decoded(const itch_bist_decoded<T>& m)
+{
+  using traits = itch_bist_msg_traits<T>;
+  if constexpr (traits::filter_by_order_book) {
+    if (auto* inst = find_instrument(m.OrderBookID)) {
+      process_msg(m, *inst);
+    }
+  } else if constexpr (traits::should_process) {
+    process_msg(m);
+  }
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_messages(const itch_bist_decoded_message* msgs, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    auto&& msg = msgs[i];
+    switch (msg.MessageType) {
+    case 'T': process_decoded(msg.seconds); break;
+    case 'R': process_decoded(msg.order_book_directory); break;
+    case 'M': process_decoded(msg.combination_order_book_leg); break;
+    case 'L': process_decoded(msg.tick_size_table_entry); break;
+    case 'S': process_decoded(msg.system_event); break;
+    case 'O': process_decoded(msg.order_book_state); break;
+    case 'A': process_decoded(msg.add_order); break;
+    case 'F': process_decoded(msg.add_order_mpid); break;
+    case 'E': process_decoded(msg.order_executed); break;
+    case 'C': process_decoded(msg.order_executed_with_price); break;
+    case 'U': process_decoded(msg.order_replace); break;
+    case 'D': process_decoded(msg.order_delete); break;
+    case 'P': process_decoded(msg.trade); break;
+    case 'Z': process_decoded(msg.equilibrium_price_update); break;
+    default: throw unknown_message_type("unknown type: " + std::string(1, msg.MessageType));
+    }
+  }
+}
+
+template <class dur_t>
+inline void print_utc_time(const char* msg, dur_t const& tsecs) {
+  using namespace std::chrono;
+  time_point<system_clock, system_clock::duration> tp(tsecs);
+  auto tm = system_clock::to_time_t(tp);
+  std::cout << msg << std::put_time(std::localtime(&tm), "%F %T") << "\n";
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_seconds>& m)
+{
+  auto new_sec = std::chrono::seconds(m.UtcSeconds);
+  if (_reports_time && new_sec - time_secs > std::chrono::seconds(10))
+  {
+    print_utc_time("working utc time: ", time_secs);
+  }
+  time_secs = new_sec;
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_book_directory>& m)
+{
+  auto order_book_id = m.OrderBookID;
+  std::string sym{ m.Symbol, ITCH_SYMBOL_LEN };
+  auto it = _instrument_by_symbol.find(sym);
+  if (it == _instrument_by_symbol.end()) {
+    // An expired OrderBookID may be reused by an instrument we do not follow.
+    map_order_book_id(order_book_id, 0);
+    return;
+  }
+  auto& inst = _instruments[it->second];
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  bool relisted = inst.shadow && inst.order_book_id != order_book_id;
+  if (inst.order_book_id != order_book_id && find_instrument(inst.order_book_id) == &inst) {
+    // The instrument was relisted under a new OrderBookID.
+    map_order_book_id(inst.order_book_id, 0);
+  }
+  inst.order_book_id = order_book_id;
+  map_order_book_id(order_book_id, it->second + 1);
+  if (!inst.shadow || relisted) {
+    // A relisted instrument starts from an empty book. The orders left on
+    // the old OrderBookID are cleared, so that relisting does not use up
+    // order table slots.
+    if (relisted) {
+      _shadow_books.clear_book(inst.shadow->index());
+    }
+    auto book = _shadow_books.add_book(order_book_id, sym, timestamp,
+                                       m.NumberOfDecimalsInPrice, _symbol_max_orders[sym]);
+    inst.shadow.emplace(_shadow_books, book);
+    inst.bbo_version = inst.shadow->bbo().version;
+  } else {
+    inst.shadow->set_timestamp(timestamp);
+    inst.shadow->set_decimals_for_price(m.NumberOfDecimalsInPrice);
+  }
+  if (relisted) {
+    if (inst.publisher) {
+      inst.publisher->publish(*inst.shadow);
+    }
+    if (inst.top_publisher) {
+      inst.top = top_of_book{};
+      inst.top.timestamp = timestamp;
+      inst.top_publisher->store(inst.top);
+    }
+  }
+  for (auto&& ob : inst.books) {
+    ob->set_timestamp(timestamp);
+    ob->set_decimals_for_price(m.NumberOfDecimalsInPrice);
+  }
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::map_order_book_id(uint32_t order_book_id, uint32_t slot)
+{
+  if (order_book_id >= max_flat_order_book_id) {
+    if (slot) {
+      _far_instrument_by_id[order_book_id] = slot;
+    } else {
+      _far_instrument_by_id.erase(order_book_id);
+    }
+    return;
+  }
+  if (order_book_id >= _instrument_by_id.size()) {
+    if (!slot) {
+      return;
+    }
+    _instrument_by_id.resize(std::max<size_t>(order_book_id + 1, _instrument_by_id.size() * 2));
+  }
+  _instrument_by_id[order_book_id] = slot;
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_combination_order_book_leg>& m)
+{
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_tick_size_table_entry>& m)
+{
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_system_event>& m)
+{
+  using namespace std::chrono;
+  auto ts = itch_bist_timestamp(m.TimestampNanoseconds);
+  nanoseconds ts_ns(ts);
+  switch (m.EventCode)
+  {
+  case system_event_code_e::StartMessage:
+  {
+    print_utc_time("borsa basladi: ", duration_cast<seconds>(ts_ns));
+  }
+  break;
+  case system_event_code_e::EndMessage:
+  {
+    print_utc_time("borsa kapandi: ", duration_cast<seconds>(ts_ns));
+  }
+  break;
+  default:
+  break;
+  }
+  flush_events();
+  _listener.on_event(event{ m.EventCode == system_event_code_e::StartMessage ? ev_opened : ev_closed, "", ts, trade{} });
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_book_state>& m, instrument& inst)
+{
+  for (auto&& ob : inst.books) {
+    ob->set_state_name(std::string(m.StateName, strnlen(m.StateName, sizeof(m.StateName))));
+  }
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_add_order>& m, instrument& inst)
+{
+  auto order_id = m.OrderID;
+  auto price = m.Price;
+  auto quantity = m.Quantity;
+  auto side = itch_bist_side(m.Side);
+  auto position = m.OrderBookPosition;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  order o{ order_id, price, quantity, side, timestamp };
+  inst.shadow->add(o, position);
+  for (auto&& ob : inst.books) {
+    ob->add(std::move(o), position);
+    ob->set_timestamp(timestamp);
+  }
+  emit(inst, book_event(inst, timestamp));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_add_order_mpid>& m, instrument& inst)
+{
+  auto order_id = m.OrderID;
+  auto price = m.Price;
+  auto quantity = m.Quantity;
+  auto side = itch_bist_side(m.Side);
+  auto position = m.OrderBookPosition;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  order o{ order_id, price, quantity, side, timestamp };
+  inst.shadow->add(o, position);
+  for (auto&& ob : inst.books) {
+    ob->add(std::move(o), position);
+    ob->set_timestamp(timestamp);
+  }
+  emit(inst, book_event(inst, timestamp));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_executed>& m, instrument& inst)
+{
+  auto quantity = m.ExecutedQuantity;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  auto oid = m.OrderID;
+  auto side = itch_bist_side(m.Side);
+  auto result = inst.shadow->execute(oid, side, quantity);
+  for (auto&& ob : inst.books) {
+    ob->execute(oid, side, quantity);
+    ob->set_timestamp(timestamp);
+  }
+  trade t{ timestamp, result.price, quantity, itch_bist_trade_sign(result.side) };
+  emit(inst, trade_event(inst, timestamp, std::move(t), ev_order_book_update | sweep_event(result)));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_executed_with_price>& m, instrument& inst)
+{
+  auto quantity = m.ExecutedQuantity;
+  auto price = m.TradePrice;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  switch (m.OccurredAtCross)
+  {
+  case 'Y':
+  {
+    trade t{ timestamp, price, quantity, trade_sign::crossing };
+    emit(inst, trade_event(inst, timestamp, std::move(t)));
+  }
+  break;
+  case 'N':
+  default:
+  {
+    auto oid = m.OrderID;
+    auto side = itch_bist_side(m.Side);
+    auto result = inst.shadow->execute(oid, side, quantity);
+    for (auto&& ob : inst.books) {
+      ob->execute(oid, side, quantity);
+      ob->set_timestamp(timestamp);
+    }
+    trade t{ timestamp, price, quantity, itch_bist_trade_sign(result.side) };
+    emit(inst, trade_event(inst, timestamp, std::move(t), ev_order_book_update | sweep_event(result)));
+  }
+  break;
+  }
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_replace>& m, instrument& inst)
+{
+  auto position = m.NewOrderBookPosition;
+  auto price = m.Price;
+  auto quantity = m.Quantity;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  auto oid = m.OrderID;
+  // The message carries the side, so the books are not asked for it and
+  // a replace is passed on like an add or a delete.
+  auto side = itch_bist_side(m.Side);
+  inst.shadow->modify(oid, side, price, quantity, timestamp, position);
+  for (auto&& ob : inst.books) {
+    ob->modify(oid, side, price, quantity, timestamp, position);
+    ob->set_timestamp(timestamp);
+  }
+  emit(inst, book_event(inst, timestamp));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_order_delete>& m, instrument& inst)
+{
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  auto oid = m.OrderID;
+  auto side = itch_bist_side(m.Side);
+  inst.shadow->remove(oid, side);
+  for (auto&& ob : inst.books) {
+    ob->remove(oid, side);
+    ob->set_timestamp(timestamp);
+  }
+  emit(inst, book_event(inst, timestamp));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_trade>& m, instrument& inst)
+{
+  auto trade_price = m.TradePrice;
+  auto quantity = m.Quantity;
+  auto timestamp = itch_bist_timestamp(m.TimestampNanoseconds);
+  trade t{ timestamp, trade_price, quantity, trade_sign::non_displayable };
+  emit(inst, trade_event(inst, timestamp, std::move(t)));
+}
+
+template<typename Listener>
+void itch_bist_handler<Listener>::process_msg(const itch_bist_decoded<itch_bist_equilibrium_price_update>& m)
+{
+
+}
+
+template<typename Listener>
+event_mask itch_bist_handler<Listener>::sweep_event(const execution& e) const
+{
+  if (e.remaining > 0) {
+    return 0;
+  }
+  return ev_sweep;
+}
+
+extern template class itch_bist_handler<callback_listener>;
+
 }
 
 }
@@ -277,13 +277,75 @@ static_assert(sizeof(itch_bist_equilibrium_price_update) == 53,
 }
 #endif
 
-template <class msg_t>
-constexpr static const bool should_process = false;
+#ifdef __cplusplus
+#include <cstddef>
 
-template <>
-constexpr static const bool should_process<itch_bist_seconds> = true;
+/*!
+* Compile time traits of an ITCH BIST message.
+*
+* Messages that address a single order book give the offset of their
+* OrderBookID, so that the handler can drop the messages of order books
+* nobody subscribed to before it decodes any other field.
+*/
+template <class msg_t>
+struct itch_bist_msg_traits {
+  //! Size of the message on the wire.
+  static constexpr size_t packet_size = sizeof(msg_t);
+  //! Whether the handler does anything with the message.
+  static constexpr bool should_process = false;
+  //! Whether the message is dropped for unsubscribed order books.
+  static constexpr bool filter_by_order_book = false;
+  static constexpr size_t order_book_id_offset = 0;
+  //! Whether the message changes the state of an order book.
+  static constexpr bool mutates_book = false;
+  //! Whether the message produces an event.
+  static constexpr bool emits_event = false;
+};
 
+template <class msg_t, bool mutates, bool emits>
+struct itch_bist_msg_traits_base {
+  static constexpr size_t packet_size = sizeof(msg_t);
+  static constexpr bool should_process = true;
+  static constexpr bool filter_by_order_book = false;
+  static constexpr size_t order_book_id_offset = 0;
+  static constexpr bool mutates_book = mutates;
+  static constexpr bool emits_event = emits;
+};
 
+template <class msg_t, size_t offset, bool mutates, bool emits>
+struct itch_bist_book_msg_traits_base : itch_bist_msg_traits_base<msg_t, mutates, emits> {
+  static constexpr bool filter_by_order_book = true;
+  static constexpr size_t order_book_id_offset = offset;
+};
 
+#define ITCH_BIST_MSG_TRAITS(msg_t, mutates, emits) \
+  template <> struct itch_bist_msg_traits<msg_t> \
+    : itch_bist_msg_traits_base<msg_t, mutates, emits> {}
+
+#define ITCH_BIST_BOOK_MSG_TRAITS(msg_t, mutates, emits) \
+  template <> struct itch_bist_msg_traits<msg_t> \
+    : itch_bist_book_msg_traits_base<msg_t, offsetof(msg_t, OrderBookID), mutates, emits> {}
+
+ITCH_BIST_MSG_TRAITS(itch_bist_seconds, false, false);
+// Directory messages map OrderBookIDs to symbols, so they are never filtered.
+ITCH_BIST_MSG_TRAITS(itch_bist_order_book_directory, true, false);
+ITCH_BIST_MSG_TRAITS(itch_bist_system_event, false, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_order_book_state, true, false);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_add_order, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_add_order_mpid, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_order_executed, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_order_executed_with_price, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_order_replace, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_order_delete, true, true);
+ITCH_BIST_BOOK_MSG_TRAITS(itch_bist_trade, false, true);
+
+#undef ITCH_BIST_MSG_TRAITS
+#undef ITCH_BIST_BOOK_MSG_TRAITS
+
+static_assert(itch_bist_msg_traits<itch_bist_add_order>::order_book_id_offset == 13,
+              "add order OrderBookID must follow the OrderID");
+static_assert(itch_bist_msg_traits<itch_bist_trade>::order_book_id_offset == 26,
+              "trade OrderBookID must follow the Quantity");
+#endif
 
 #endif
@@ -0,0 +1,548 @@
+#pragma once
+
+#include "nasdaq/itch_bist_handler.hh"
+#include "spsc_ring.hh"
+#include "thread_topology.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace helix {
+
+namespace nasdaq {
+
+// Sharded NASDAQ TotalView-ITCH BIST v.4.5 feed handler
+//
+// The thread that calls process_packet() only frames and decodes messages.
+// Book messages are routed to N shards, each an itch_bist_handler running
+// on a worker thread of its own, so the books of a full market are built on
+// N cores.
+//
+// Every instrument is owned by one shard, picked round robin when it is
+// subscribed, and the directory message that lists the instrument tells the
+// decoding thread which shard an OrderBookID goes to. Messages of books
+// nobody follows are dropped before they are decoded. A shard is passed the
+// messages of its instruments in feed order, so the books and events of an
+// instrument are the same as with a single handler.
+//
+// The messages of a packet are queued to the shards at once when
+// flush_events() is called, which binaryfile_session does after every
+// message, or every flush_interval messages when coalescing, and on
+// session::flush(). When coalescing, the shards emit the events held back
+// once they applied the messages queued with a flush.
+//
+// Every shard passes events to a copy of the listener, on the shard's
+// thread. Events of an instrument always come from the same thread, events
+// of different instruments may come concurrently. Seconds messages and
+// system events go to every shard; only the first prints the working time. A system event is a barrier: each shard
+// emits what came before it and waits, and the last shard to arrive emits
+// it once, so that it comes after every event the feed sent before it and
+// before every event sent after it.
+//
+// Shards with no messages, and the decoding thread when it waits for a
+// shard, yield for spin_time and then park until they are woken, so that an
+// idle feed does not keep N cores busy.
+//
+// Subscriptions, callbacks and coalescing are set up before processing
+// starts, as with itch_bist_handler.
+//
+template<typename Listener = callback_listener>
+class itch_bist_sharded_handler {
+private:
+    //! Messages queued to a shard and not applied yet.
+    using message_ring = spsc_ring<itch_bist_decoded_message, 16384>;
+    //! Message type of the marker queued after the messages of a packet
+    //! when coalescing.
+    static constexpr char end_of_packet = '\0';
+    static constexpr uint32_t no_order_book_id = ~uint32_t{ 0 };
+    //! OrderBookIDs below this are routed through the flat table.
+    static constexpr uint32_t max_flat_order_book_id = uint32_t{ 1 } << 20;
+    //! How long a thread with nothing to do yields before it parks.
+    static constexpr std::chrono::microseconds spin_time{ 50 };
+
+    struct shard {
+        itch_bist_handler<Listener> handler;
+        message_ring messages;
+        //! Messages of the packet being decoded.
+        std::vector<itch_bist_decoded_message> batch;
+        thread_placement placement;
+        //! Messages queued, written by the decoding thread.
+        alignas(64) std::atomic<uint64_t> queued{ 0 };
+        //! Messages applied, written by the shard.
+        alignas(64) std::atomic<uint64_t> applied{ 0 };
+        //! Where the shard waits for messages.
+        parking_spot parking;
+        std::thread thread;
+
+        explicit shard(Listener listener)
+            : handler{ std::move(listener) }
+        { }
+    };
+
+    //! A subscribed symbol and where its messages go.
+    struct listing {
+        uint32_t shard;
+        //! The OrderBookID the symbol was last listed with, if any.
+        uint32_t order_book_id{ no_order_book_id };
+    };
+
+    std::vector<std::unique_ptr<shard>> _shards;
+    //! Listing by padded symbol.
+    std::unordered_map<std::string, listing> _listings;
+    //! Shard index plus one by OrderBookID, zero for unsubscribed books.
+    std::vector<uint32_t> _shard_by_id;
+    //! Shard index plus one for OrderBookIDs too large for the table.
+    std::unordered_map<uint32_t, uint32_t> _far_shard_by_id;
+    bool _started{ false };
+    bool _coalescing{ false };
+    std::atomic<bool> _stopping{ false };
+    //! Where the decoding thread waits for a shard to make room or apply
+    //! messages.
+    parking_spot _decoder_parking;
+    //! Where shards wait at a system event for each other.
+    std::mutex _barrier_mutex;
+    std::condition_variable _barrier_cv;
+    size_t _barrier_arrived{ 0 };
+    //! Counts system events emitted, so that waiting shards know theirs was.
+    uint64_t _barrier_generation{ 0 };
+    //! First exception thrown by a shard, rethrown on the decoding thread.
+    std::exception_ptr _error;
+    std::atomic<bool> _failed{ false };
+    //! Set once _error is stored.
+    std::atomic<bool> _error_stored{ false };
+public:
+    /// \brief Creates a handler with one shard per core left after the
+    /// decoding thread.
+    itch_bist_sharded_handler()
+        : itch_bist_sharded_handler(default_shard_count())
+    { }
+    /// \param placements where the thread of each shard runs, see
+    ///        thread_topology; shards past the end are unpinned.
+    explicit itch_bist_sharded_handler(size_t shards, Listener listener = Listener{},
+                                       std::vector<thread_placement> placements = {});
+    ~itch_bist_sharded_handler();
+    itch_bist_sharded_handler(const itch_bist_sharded_handler&) = delete;
+    itch_bist_sharded_handler& operator=(const itch_bist_sharded_handler&) = delete;
+
+    static size_t default_shard_count() {
+        auto cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+    size_t shard_count() const { return _shards.size(); }
+    //! Shards emit events on threads of their own.
+    bool calls_back_concurrently() const { return _shards.size() > 1; }
+    //! Returns the listener of a shard.
+    Listener& listener(size_t shard) { return _shards[shard]->handler.listener(); }
+    bool is_rth_timestamp(uint64_t timestamp) const;
+    std::string subscribe(std::string sym, size_t max_orders);
+    void register_callback(event_callback callback);
+    void register_event_callback(event_ref_callback callback);
+    void set_coalescing(bool coalesce);
+    //! Queues the messages of the packet to the shards.
+    void flush_events();
+    size_t process_packet(const net::packet_view& packet);
+    void register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent);
+    //! See itch_bist_handler::share_book(); the book is built by a shard.
+    const book_publisher& share_book(std::string symbol, size_t max_orders);
+    //! See itch_bist_handler::share_top_of_book().
+    const top_of_book_publisher& share_top_of_book(std::string symbol, size_t max_orders);
+    /// \brief Waits until the shards have applied every message queued so
+    /// far, and rethrows the first exception a shard threw.
+    void wait();
+private:
+    template<typename T>
+    size_t route_msg(const net::packet_view& packet);
+    void route_directory(const net::packet_view& packet);
+    //! Decodes a message into the batch of a shard.
+    void queue(shard& s, const net::packet_view& packet);
+    //! Returns the shard of a symbol, assigning one if it is new.
+    itch_bist_handler<Listener>& handler_for(const std::string& symbol);
+    shard* find_shard(uint32_t order_book_id) {
+        uint32_t slot = 0;
+        if (order_book_id < _shard_by_id.size()) {
+            slot = _shard_by_id[order_book_id];
+        } else if (order_book_id >= max_flat_order_book_id && !_far_shard_by_id.empty()) {
+            if (auto it = _far_shard_by_id.find(order_book_id); it != _far_shard_by_id.end()) {
+                slot = it->second;
+            }
+        }
+        return slot ? _shards[slot - 1].get() : nullptr;
+    }
+    void map_order_book_id(uint32_t order_book_id, uint32_t slot);
+    void start();
+    void stop();
+    void run(shard& s);
+    //! Emits a system event once every shard reached it.
+    void system_event_barrier(shard& s, const itch_bist_decoded_message& msg);
+    //! Keeps the first exception of the shards.
+    void fail(std::exception_ptr error);
+    void rethrow();
+    static std::string padded_symbol(std::string symbol);
+};
+
+template<typename Listener>
+itch_bist_sharded_handler<Listener>::itch_bist_sharded_handler(size_t shards, Listener listener,
+                                                               std::vector<thread_placement> placements)
+{
+  if (shards == 0) {
+    throw std::invalid_argument("a sharded handler needs at least one shard");
+  }
+  _shards.reserve(shards);
+  for (size_t i = 0; i < shards; i++) {
+    _shards.push_back(std::make_unique<shard>(listener));
+    // Every shard is passed the seconds messages, one is enough to print
+    // the time.
+    _shards.back()->handler.set_reports_time(i == 0);
+    if (i < placements.size()) {
+      _shards.back()->placement = placements[i];
+    }
+  }
+}
+
+template<typename Listener>
+itch_bist_sharded_handler<Listener>::~itch_bist_sharded_handler()
+{
+  stop();
+}
+
+template<typename Listener>
+std::string itch_bist_sharded_handler<Listener>::padded_symbol(std::string symbol)
+{
+  auto padding = ITCH_SYMBOL_LEN - symbol.size();
+  if (padding > 0) {
+    symbol.insert(symbol.size(), padding, ' ');
+  }
+  return symbol;
+}
+
+template<typename Listener>
+itch_bist_handler<Listener>& itch_bist_sharded_handler<Listener>::handler_for(const std::string& symbol)
+{
+  auto sym = padded_symbol(symbol);
+  auto shard = static_cast<uint32_t>(_listings.size() % _shards.size());
+  auto it = _listings.emplace(std::move(sym), listing{ shard }).first;
+  return _shards[it->second.shard]->handler;
+}
+
+template<typename Listener>
+bool itch_bist_sharded_handler<Listener>::is_rth_timestamp(uint64_t timestamp) const
+{
+  return _shards.front()->handler.is_rth_timestamp(timestamp);
+}
+
+template<typename Listener>
+std::string itch_bist_sharded_handler<Listener>::subscribe(std::string sym, size_t max_orders)
+{
+  return handler_for(sym).subscribe(sym, max_orders);
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::register_callback(event_callback callback)
+{
+  for (auto&& s : _shards) {
+    s->handler.register_callback(callback);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::register_event_callback(event_ref_callback callback)
+{
+  for (auto&& s : _shards) {
+    s->handler.register_event_callback(callback);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::set_coalescing(bool coalesce)
+{
+  flush_events();
+  wait();
+  _coalescing = coalesce;
+  for (auto&& s : _shards) {
+    s->handler.set_coalescing(coalesce);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::register_for_symbol(std::string symbol, std::unique_ptr<order_book_agent> ob_agent)
+{
+  handler_for(symbol).register_for_symbol(symbol, std::move(ob_agent));
+}
+
+template<typename Listener>
+const book_publisher& itch_bist_sharded_handler<Listener>::share_book(std::string symbol, size_t max_orders)
+{
+  return handler_for(symbol).share_book(symbol, max_orders);
+}
+
+template<typename Listener>
+const top_of_book_publisher& itch_bist_sharded_handler<Listener>::share_top_of_book(std::string symbol, size_t max_orders)
+{
+  return handler_for(symbol).share_top_of_book(symbol, max_orders);
+}
+
+template<typename Listener>
+size_t itch_bist_sharded_handler<Listener>::process_packet(const net::packet_view& packet)
+{
+  auto* msg = packet.cast<itch_bist_message>();
+  switch (msg->MessageType) {
+  case 'T': return route_msg<itch_bist_seconds>(packet);
+  case 'R': return route_msg<itch_bist_order_book_directory>(packet);
+  case 'M': return route_msg<itch_bist_combination_order_book_leg>(packet);
+  case 'L': return route_msg<itch_bist_tick_size_table_entry>(packet);
+  case 'S': return route_msg<itch_bist_system_event>(packet);
+  case 'O': return route_msg<itch_bist_order_book_state>(packet);
+  case 'A': return route_msg<itch_bist_add_order>(packet);
+  case 'F': return route_msg<itch_bist_add_order_mpid>(packet);
+  case 'E': return route_msg<itch_bist_order_executed>(packet);
+  case 'C': return route_msg<itch_bist_order_executed_with_price>(packet);
+  case 'U': return route_msg<itch_bist_order_replace>(packet);
+  case 'D': return route_msg<itch_bist_order_delete>(packet);
+  case 'P': return route_msg<itch_bist_trade>(packet);
+  case 'Z': return route_msg<itch_bist_equilibrium_price_update>(packet);
+  default: throw unknown_message_type("unknown type: " + std::string(1, msg->MessageType));
+  }
+}
+
+template<typename Listener>
+template<typename T>
+size_t itch_bist_sharded_handler<Listener>::route_msg(const net::packet_view& packet)
+{
+  using traits = itch_bist_msg_traits<T>;
+  if constexpr (traits::filter_by_order_book) {
+    auto order_book_id = load_be<uint32_t>(packet.buf() + traits::order_book_id_offset);
+    if (auto* s = find_shard(order_book_id)) {
+      queue(*s, packet);
+    }
+  } else if constexpr (std::is_same_v<T, itch_bist_order_book_directory>) {
+    route_directory(packet);
+  } else if constexpr (std::is_same_v<T, itch_bist_system_event>) {
+    // Shards wait for each other at a system event, so it is queued to all
+    // of them in a batch of its own; otherwise a shard could wait at it for
+    // another whose batch is stuck behind the first one's full ring.
+    flush_events();
+    for (auto&& s : _shards) {
+      queue(*s, packet);
+    }
+    flush_events();
+  } else if constexpr (traits::should_process) {
+    for (auto&& s : _shards) {
+      queue(*s, packet);
+    }
+  }
+  return traits::packet_size;
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::route_directory(const net::packet_view& packet)
+{
+  auto m = itch_bist_decoded<itch_bist_order_book_directory>::decode(packet.buf());
+  auto it = _listings.find(std::string{ m.Symbol, ITCH_SYMBOL_LEN });
+  if (it == _listings.end()) {
+    // An expired OrderBookID may be reused by an instrument we do not follow.
+    map_order_book_id(m.OrderBookID, 0);
+    return;
+  }
+  auto& l = it->second;
+  auto* s = _shards[l.shard].get();
+  if (l.order_book_id != m.OrderBookID && find_shard(l.order_book_id) == s) {
+    // The instrument was relisted under a new OrderBookID.
+    map_order_book_id(l.order_book_id, 0);
+  }
+  l.order_book_id = m.OrderBookID;
+  map_order_book_id(m.OrderBookID, l.shard + 1);
+  queue(*s, packet);
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::map_order_book_id(uint32_t order_book_id, uint32_t slot)
+{
+  if (order_book_id >= max_flat_order_book_id) {
+    if (slot) {
+      _far_shard_by_id[order_book_id] = slot;
+    } else {
+      _far_shard_by_id.erase(order_book_id);
+    }
+    return;
+  }
+  if (order_book_id >= _shard_by_id.size()) {
+    if (!slot) {
+      return;
+    }
+    _shard_by_id.resize(std::max<size_t>(order_book_id + 1, _shard_by_id.size() * 2));
+  }
+  _shard_by_id[order_book_id] = slot;
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::queue(shard& s, const net::packet_view& packet)
+{
+  s.batch.emplace_back();
+  itch_bist_decode(packet.buf(), packet.len(), s.batch.back());
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::flush_events()
+{
+  rethrow();
+  if (!_started) {
+    start();
+  }
+  for (auto&& s : _shards) {
+    if (s->batch.empty()) {
+      continue;
+    }
+    if (_coalescing) {
+      s->batch.emplace_back();
+      s->batch.back().MessageType = end_of_packet;
+    }
+    auto* msgs = s->batch.data();
+    auto count = s->batch.size();
+    while (count) {
+      auto pushed = s->messages.try_push(msgs, count);
+      msgs += pushed;
+      count -= pushed;
+      if (pushed) {
+        s->parking.wake();
+      }
+      if (count) {
+        // The shard is behind by a full ring.
+        _decoder_parking.wait([s = s.get()] { return !s->messages.full(); }, spin_time);
+      }
+    }
+    s->queued.store(s->queued.load(std::memory_order_relaxed) + s->batch.size(), std::memory_order_relaxed);
+    s->batch.clear();
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::wait()
+{
+  for (auto&& s : _shards) {
+    auto queued = s->queued.load(std::memory_order_relaxed);
+    _decoder_parking.wait([s = s.get(), queued] {
+      return s->applied.load(std::memory_order_acquire) >= queued;
+    }, spin_time);
+  }
+  rethrow();
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::rethrow()
+{
+  if (_error_stored.load(std::memory_order_acquire) && _error) {
+    auto error = std::exchange(_error, nullptr);
+    std::rethrow_exception(error);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::fail(std::exception_ptr error)
+{
+  if (!_failed.exchange(true)) {
+    _error = std::move(error);
+    _error_stored.store(true, std::memory_order_release);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::start()
+{
+  _started = true;
+  for (auto&& s : _shards) {
+    s->thread = std::thread{ [this, s = s.get()] { run(*s); } };
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::stop()
+{
+  _stopping.store(true, std::memory_order_release);
+  for (auto&& s : _shards) {
+    s->parking.wake();
+    if (s->thread.joinable()) {
+      s->thread.join();
+    }
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::run(shard& s)
+{
+  try {
+    pin_current_thread(s.placement);
+  } catch (...) {
+    fail(std::current_exception());
+  }
+  auto apply = [this, &s](const itch_bist_decoded_message& msg) {
+    if (msg.MessageType == 'S') {
+      system_event_barrier(s, msg);
+    } else {
+      try {
+        if (msg.MessageType == end_of_packet) {
+          s.handler.flush_events();
+        } else {
+          s.handler.process_messages(&msg, 1);
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+    // Counted even if a callback threw, or wait() would never return.
+    s.applied.store(s.applied.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  };
+  for (;;) {
+    if (s.messages.consume(apply)) {
+      // The decoding thread may wait for room or for messages to be applied.
+      _decoder_parking.wake();
+      continue;
+    }
+    if (_stopping.load(std::memory_order_acquire) && s.messages.empty()) {
+      return;
+    }
+    s.parking.wait([this, &s] {
+      return !s.messages.empty() || _stopping.load(std::memory_order_acquire);
+    }, spin_time);
+  }
+}
+
+template<typename Listener>
+void itch_bist_sharded_handler<Listener>::system_event_barrier(shard& s, const itch_bist_decoded_message& msg)
+{
+  try {
+    // Coalesced events of earlier messages come before the system event.
+    s.handler.flush_events();
+  } catch (...) {
+    fail(std::current_exception());
+  }
+  std::unique_lock<std::mutex> lock(_barrier_mutex);
+  auto generation = _barrier_generation;
+  if (++_barrier_arrived < _shards.size()) {
+    // The decoding thread queued the system event to every shard before
+    // anything after it, so the others get here without it.
+    _barrier_cv.wait(lock, [this, generation] { return _barrier_generation != generation; });
+    return;
+  }
+  try {
+    s.handler.process_messages(&msg, 1);
+  } catch (...) {
+    fail(std::current_exception());
+  }
+  _barrier_arrived = 0;
+  _barrier_generation++;
+  _barrier_cv.notify_all();
+}
+
+extern template class itch_bist_sharded_handler<callback_listener>;
+
+}
+
+}
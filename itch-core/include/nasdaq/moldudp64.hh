@@ -43,6 +43,8 @@ public:
 
     virtual void register_callback(event_callback callback) override;
 
+    virtual void set_coalescing(bool coalesce) override;
+
     virtual void set_send_callback(send_callback callback) override;
 
     virtual size_t process_packet(const net::packet_view& packet) override;
@@ -76,6 +78,12 @@ void moldudp64_session<Handler>::register_callback(event_callback callback)
     _handler.register_callback(callback);
 }
 
+template<typename Handler>
+void moldudp64_session<Handler>::set_coalescing(bool coalesce)
+{
+    _handler.set_coalescing(coalesce);
+}
+
 template<typename Handler>
 void moldudp64_session<Handler>::set_send_callback(send_callback send_cb)
 {
@@ -114,6 +122,7 @@ size_t moldudp64_session<Handler>::process_packet(const net::packet_view& packet
         p += message_length;
         _expected_seq_no++;
     }
+    _handler.flush_events();
     if (_state == moldudp64_state::gap_fill) {
         if (_expected_seq_no >= *_sync_to_seq_no) {
             _state = moldudp64_state::synchronized;
@@ -6,10 +6,7 @@
 /// querying per-asset order book state such as top and depth of book bid
 /// and ask price and size.
 
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
+#include "book_engine.hh"
 
 #include <unordered_map>
 #include <cstdint>
@@ -17,7 +14,7 @@
 #include <memory>
 #include <string>
 #include <list>
-#include <map>
+#include <vector>
 #include <unordered_map>
 #include <memory_resource>
 
@@ -26,180 +23,113 @@ namespace helix {
 /// \addtogroup order-book
 /// @{
 
-/// \brief Order side.
-enum class side_type : uint8_t {
-    /// Buy order
-    buy = 1,
-    /// Sell order
-    sell = 2,
-};
-
-/// \brief Trading state.
-enum class trading_state : uint8_t {
-    /// Trading state is unknown.
-    unknown,
-    /// Trading is halted.
-    halted,
-    /// Trading is paused.
-    paused,
-    /// Quotation only period.
-    quotation_only,
-    /// Trading is ongoing.
-    trading,
-    /// Auction period.
-    auction,
-};
-
-struct price_level;
-
-/// \brief Order is a request to buy or sell quantity of asset at a
-/// specified price.
-struct order final {
-    price_level* level;
-    uint64_t     id;
-    uint64_t     price;
-    uint64_t     quantity;
-    uint64_t     timestamp;
-    side_type    side;
-
-    order(uint64_t id, uint64_t price, uint64_t quantity, side_type side, uint64_t timestamp)
-        : level{nullptr}
-        , id{id}
-        , price{price}
-        , quantity{quantity}
-        , side{side}
-        , timestamp{timestamp}
-    {}
-};
-
-struct order_hash {
-  size_t operator()(const order& ord) const {
-    return std::hash<decltype(order::id)>()(ord.id);
-  }
-};
-
-struct order_equal_to {
-  bool operator()(const order& lhs, const order& rhs) const {
-    return lhs.id == rhs.id;
-  }
-};
-
-/// \brief Price level is a time-prioritized list of orders with the same price.
-struct price_level {
-    explicit price_level(uint64_t price_ = 0)
-        : price(price_)
-        , size(0)
-    { }
-
-    uint64_t price;
-    uint64_t size;
-};
-
-/// \brief Order execution details.
-struct execution {
-  //! The price order was executed with.
-  uint64_t price {0};
-  //! The side of the liquidity taker of the trade.
-  side_type side{0};
-  //! The number of remaining quantity on the traded price level.
-  uint64_t remaining{ 0 };
-  bool is_valid{ false };
-  execution() = default;
-  execution(uint64_t price, side_type side, uint64_t remaining);
-  bool valid() const { return is_valid; }
-};
-
 /// \brief Order book is a price-time prioritized list of buy and sell
 /// orders.
+///
+/// An order book is a view over one book of a book_engine. A book created
+/// from a symbol alone owns a private engine holding just that book.
 class order_book {
-    using order_set = boost::multi_index::multi_index_container<
-                          order,
-                          boost::multi_index::indexed_by<
-                              boost::multi_index::hashed_unique<
-                                  boost::multi_index::member<order, uint64_t, &order::id>
-                              >
-                          >
-                      >;
-
-    /* boyle olacak herhalde?!?
-        using order_set = boost::multi_index::multi_index_container<
-                          order,
-                          boost::multi_index::indexed_by<
-                              boost::multi_index::hashed_non_unique<
-                                  boost::multi_index::composite_key<
-                                    order,
-                                    boost::multi_index::member<order, uint64_t, &order::id>,
-                                    boost::multi_index::member<order, side_type, &order::side>
-                                  > 
-                              >
-                          >
-                      >;
-    */
-    /*
-    * ayn order::id ile hem buy hem de sell order ekleme mesaj gelebiliyor. "IDGYO.E" iin byle bir data var. 
-    * bu nedenle multi_index_container unique olmak yerine order::id ve order::side'a gre tutulmal
-    */
-    //using order_set = std::unordered_map<decltype(order::id), order>;
-    using iterator = order_set::const_iterator;
-
-    std::string _symbol;
-    std::string _state_name;
-    uint64_t _timestamp;
-    trading_state _state;
-    uint16_t _num_decimals_for_price; // A value of 256 means that the instrument is traded in fractions (each fraction is 1/256). 
-    order_set _orders;
-    size_t _max_orders;
-    std::map<uint64_t, price_level, std::greater<uint64_t>> _bids;
-    std::map<uint64_t, price_level, std::less   <uint64_t>> _asks;
+    //! Private engine of a standalone book, null for a view.
+    std::unique_ptr<book_engine> _owned_engine;
+    book_engine* _engine;
+    book_engine::book_index _book;
 public:
-    order_book(std::string symbol, uint64_t timestamp, size_t max_orders = 0);
-    order_book(std::string symbol, uint64_t timestamp, uint16_t num_decimals_for_price, size_t max_orders = 0);
+    /// \param resource memory resource for the orders and levels of the book,
+    ///        see order_book_arena for one that keeps the steady state off the
+    ///        global allocator.
+    order_book(std::string symbol, uint64_t timestamp, size_t max_orders = 0,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    order_book(std::string symbol, uint64_t timestamp, uint16_t num_decimals_for_price, size_t max_orders = 0,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// \brief Creates a view over a book of an engine.
+    order_book(book_engine& engine, book_engine::book_index book);
+
+    book_engine& engine() const {
+        return *_engine;
+    }
+
+    book_engine::book_index index() const {
+        return _book;
+    }
 
     std::string_view symbol() const {
-        return _symbol;
+        return _engine->_symbols[_book];
     }
 
     void set_timestamp(uint64_t timestamp) {
-        _timestamp = timestamp;
+        _engine->_timestamps[_book] = timestamp;
     }
 
     uint64_t timestamp() const {
-        return _timestamp;
+        return _engine->_timestamps[_book];
     }
 
     void set_state(trading_state state) {
-        _state = state;
+        _engine->_states[_book] = state;
     }
 
     trading_state state() const {
-        return _state;
+        return _engine->_states[_book];
     }
 
     void set_state_name(std::string state_name) {
-      _state_name = std::move(state_name);
+      _engine->_state_names[_book] = state_name;
     }
 
     std::string_view state_name() const {
-      return _state_name;
+      return _engine->_state_names[_book];
     }
 
     void set_decimals_for_price(uint16_t dec) {
-      _num_decimals_for_price = dec;
+      _engine->_num_decimals_for_price[_book] = dec;
     }
 
     uint16_t decimals_for_price() const {
-      return _num_decimals_for_price;
+      return _engine->_num_decimals_for_price[_book];
     }
 
     size_t max_orders() const {
-      return _max_orders;
+      return _engine->_book_max_orders[_book];
     }
 
-    void add(order order);
-    void replace(uint64_t order_id, order order);
+    /// \brief Keeps the timestamp of every order added from now on, which
+    /// costs 8 more bytes per order. Off by default.
+    void keep_order_timestamps(bool keep) {
+      _engine->_keep_order_timestamps[_book] = keep;
+      if (keep) {
+        _engine->_order_timestamps.reserve(_engine->_max_orders);
+      }
+    }
+
+    /// \brief Adds an order to the book.
+    ///
+    /// \param position rank of the order among all orders on its side of the
+    ///        book (ITCH OrderBookPosition, 1 is the first). Zero or a rank
+    ///        past the end of its level queues the order at the back.
+    void add(order order, uint32_t position = 0);
+    void replace(uint64_t order_id, order order, uint32_t position = 0);
+
+    /// \brief Modifies an order in place.
+    ///
+    /// The side is the one the ITCH replace message carries; an order id is
+    /// only unique per side, so there is no modify that looks it up. The
+    /// order keeps its record. A quantity change at an unchanged price
+    /// only adjusts the level size, and a price change moves the order
+    /// between levels without touching the order table.
+    ///
+    /// \param position new rank of the order on its side of the book (ITCH
+    ///        NewOrderBookPosition). Zero keeps the order's place in its
+    ///        queue when the price is unchanged and queues it at the back of
+    ///        the new level otherwise.
+    void modify(uint64_t order_id, side_type side, uint64_t price, uint64_t quantity,
+                uint64_t timestamp, uint32_t position = 0);
     void cancel(uint64_t order_id, uint64_t quantity);
+    void cancel(uint64_t order_id, side_type side, uint64_t quantity);
     execution execute(uint64_t order_id, uint64_t quantity);
+    execution execute(uint64_t order_id, side_type side, uint64_t quantity);
     void remove(uint64_t order_id);
+    void remove(uint64_t order_id, side_type side);
     side_type side(uint64_t order_id) const;
 
     size_t bid_levels() const;
@@ -215,14 +145,79 @@ public:
     price_level ask_level(size_t level) const;
     uint64_t midprice (size_t level) const;
 
+    /// \brief Returns the best bid and offer.
+    best_bid_offer bbo() const;
+
+    /// \brief Returns the version of the best bid and offer, which changes
+    /// whenever the price or size of a best level does. Comparing it with a
+    /// version seen before is cheaper than reading the levels.
+    uint64_t bbo_version() const {
+        return _engine->_bbo_versions[_book];
+    }
+
+    const order_record* find(uint64_t order_id, side_type side) const;
+
+    /// \brief Returns the time the order was added, or zero unless order
+    /// timestamps are kept.
+    uint64_t order_timestamp(const order_record& o) const;
+
+    /// \brief Returns the first order in time priority at a level.
+    const order_record* front(const price_level& level) const;
+
+    /// \brief Returns the order queued just ahead of o at its level or nullptr.
+    const order_record* ahead(const order_record& o) const;
+
+    /// \brief Returns the order queued just behind o at its level or nullptr.
+    const order_record* behind(const order_record& o) const;
+
+    /// \brief Returns the rank of o in its level queue (1 is the front) by
+    /// walking the orders ahead of it.
+    size_t queue_position(const order_record& o) const;
+
+    /// \brief Returns a view over the bid levels, best first. The view is
+    /// invalidated by the next modification of the book.
+    depth_view bid_depth() const {
+        return bids().depth(_engine->_levels);
+    }
+
+    /// \brief Returns a view over the ask levels, best first. The view is
+    /// invalidated by the next modification of the book.
+    depth_view ask_depth() const {
+        return asks().depth(_engine->_levels);
+    }
+
 private:
-    void remove_impl(iterator& iter);
+    book_engine::bid_ladder& bids() const {
+        return _engine->_bids[_book];
+    }
+
+    book_engine::ask_ladder& asks() const {
+        return _engine->_asks[_book];
+    }
+
+    //! Looks an order up on both sides, buy side first.
+    order_record* lookup(uint64_t order_id);
+    const order_record* lookup(uint64_t order_id) const;
+
+    //! Bumps the BBO version if the level of o is the best one of its side.
+    void note_level_change(const order_record& o);
+    void stamp(const order_record& o, uint64_t timestamp);
+    void enqueue(order_record& o, uint32_t position);
+    void dequeue(const order_record& o);
+    //! Counts orders queued or dequeued at the level of o, see
+    //! price_ladder::orders_ahead().
+    void count_orders(const order_record& o, int64_t n);
+    void modify_impl(order_record& o, uint64_t price, uint64_t quantity, uint64_t timestamp,
+                     uint32_t position);
+    void cancel_impl(order_record& o, uint64_t quantity);
+    execution execute_impl(order_record& o, uint64_t quantity);
+    void remove_impl(const order_record& o);
 
     template<typename T>
-    void remove_impl(const order& o, T& levels);
+    void remove_impl(const order_record& o, T& levels);
 
     template<typename T>
-    price_level& lookup_or_create(T& levels, uint64_t price);
+    level_pool::handle lookup_or_create(T& levels, uint64_t price);
 
     friend class order_book_agent;
 };
@@ -1,14 +1,86 @@
 #pragma once
 #include "order_book.hh"
+#include "spsc_ring.hh"
 #include <boost/asio/thread_pool.hpp>
+#include <atomic>
+#include <exception>
+#include <memory>
 
 namespace helix 
 {
   using boost::asio::thread_pool;
+
+  //! Book command is a change to an order book queued for the book thread.
+  struct book_command {
+    enum class type : uint8_t {
+      set_timestamp,
+      set_state,
+      set_state_name,
+      set_decimals_for_price,
+      add,
+      replace,
+      modify,
+      cancel,
+      remove,
+      execute,
+    };
+
+    type kind;
+    //! Side of the order. Cancel, remove and execute leave it zero when the
+    //! book has to look it up; add, replace and modify always set it.
+    side_type side;
+    trading_state state;
+    uint8_t state_name_length;
+    uint32_t position;
+    //! Order the command applies to; the decimals of set_decimals_for_price.
+    uint64_t order_id;
+    union {
+      //! The new order of add and replace, the new price, quantity and
+      //! timestamp of modify, the quantity of cancel and execute and the
+      //! timestamp of set_timestamp.
+      struct {
+        uint64_t id;
+        uint64_t price;
+        uint64_t quantity;
+        uint64_t timestamp;
+      } args;
+      char state_name[32];
+    };
+  };
+
+  /// \brief Order book agent applies changes to a book on the thread that
+  /// owns it.
+  ///
+  /// Changes are queued as book_command values on a ring that the book
+  /// thread drains in batches, so handing one over neither allocates nor
+  /// locks; only the first change of a batch posts to the thread pool.
+  /// Queries drain the ring before reading the book and wait for the
+  /// answer; a query rethrows the first exception a queued command threw
+  /// since the previous query. The thread pool must run a single thread, and it must be
+  /// joined before the agent is destroyed.
   class order_book_agent
   {
+    using command_ring = spsc_ring<book_command, 4096>;
+    //! Most commands applied before the drain gives the pool back.
+    static constexpr size_t drain_batch = 1024;
+
     mutable thread_pool* ob_thread{ nullptr };
     order_book* ob{ nullptr };
+    std::unique_ptr<command_ring> commands;
+    drain_flag drain_scheduled;
+    //! First exception a queued command threw, rethrown by the next query.
+    mutable std::exception_ptr error;
+
+    void push(const book_command& cmd);
+    void schedule_drain();
+    //! Applies a batch of commands on the book thread.
+    void drain();
+    //! Applies every queued command, called on the book thread before a
+    //! query, and rethrows the error of a command applied earlier.
+    void flush() const;
+    //! Applies up to max queued commands, keeping the first error.
+    void apply_queued(size_t max) const;
+    void apply(const book_command& cmd) const;
   public:
     order_book_agent() = default;
     order_book_agent(order_book* ob_);
@@ -17,11 +89,20 @@ namespace helix
     void set_timestamp(uint64_t timestamp);
     void set_state(trading_state state);
     void set_state_name(const std::string& state_name);
-    void add(order order);
-    void replace(uint64_t order_id, order order);
+    void add(order order, uint32_t position = 0);
+    void replace(uint64_t order_id, order order, uint32_t position = 0);
+    //! Modifies an order on the side the replace message tells, without
+    //! waiting for the book.
+    void modify(uint64_t order_id, side_type side, uint64_t price, uint64_t quantity,
+                uint64_t timestamp, uint32_t position = 0);
     void cancel(uint64_t order_id, uint64_t quantity);
+    void cancel(uint64_t order_id, side_type side, uint64_t quantity);
     void remove(uint64_t order_id);
-    execution execute(uint64_t order_id, uint64_t quantity);
+    void remove(uint64_t order_id, side_type side);
+    //! Executes an order without waiting for the book; the execution is
+    //! attributed by whoever keeps a copy of the book, see itch_bist_handler.
+    void execute(uint64_t order_id, uint64_t quantity);
+    void execute(uint64_t order_id, side_type side, uint64_t quantity);
     void set_decimals_for_price(uint16_t dec);
 
 
@@ -48,6 +129,7 @@ namespace helix
 
     price_level bid_level(size_t level) const;
     price_level ask_level(size_t level) const;
+    best_bid_offer bbo() const;
   };
 
 
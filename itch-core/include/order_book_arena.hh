@@ -0,0 +1,131 @@
+#pragma once
+
+/// \file order_book_arena.hh
+///
+/// Memory resources for order books.
+
+#include "order_book.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace helix {
+
+/// \addtogroup order-book
+/// @{
+
+/// \brief Counting resource forwards to an upstream resource and counts the
+/// allocations and deallocations that pass through it.
+class counting_resource : public std::pmr::memory_resource {
+public:
+    explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : _upstream{ upstream }
+    { }
+
+    size_t allocations() const {
+        return _allocations;
+    }
+
+    size_t deallocations() const {
+        return _deallocations;
+    }
+
+    //! Total number of bytes allocated, not net of deallocations.
+    size_t bytes() const {
+        return _bytes;
+    }
+
+    void reset() {
+        _allocations = 0;
+        _deallocations = 0;
+        _bytes = 0;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        _allocations++;
+        _bytes += bytes;
+        return _upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        _deallocations++;
+        _upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* _upstream;
+    size_t _allocations{ 0 };
+    size_t _deallocations{ 0 };
+    size_t _bytes{ 0 };
+};
+
+/// \brief Order book arena is the memory of one order book or book engine,
+/// taken from the upstream resource in a single block when the arena is
+/// created.
+///
+/// A pool resource recycles the level and index nodes the book frees, and
+/// the block sized from the expected number of orders and levels backs the
+/// pools, so once the book has warmed up adds, executes and deletes never
+/// reach the upstream resource. A book that outgrows the estimate keeps
+/// working and takes further memory from upstream.
+///
+/// The arena is not thread-safe and must outlive the book using it.
+class order_book_arena {
+public:
+    order_book_arena(size_t max_orders, size_t max_levels,
+                     std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _upstream{ upstream }
+        , _size{ bytes_for(max_orders, max_levels) }
+        , _storage{ upstream->allocate(_size, alignof(std::max_align_t)) }
+        , _buffer{ _storage, _size, upstream }
+        , _pool{ &_buffer }
+    { }
+
+    ~order_book_arena() {
+        _pool.release();
+        _buffer.release();
+        _upstream->deallocate(_storage, _size, alignof(std::max_align_t));
+    }
+
+    order_book_arena(const order_book_arena&) = delete;
+    order_book_arena& operator=(const order_book_arena&) = delete;
+
+    std::pmr::memory_resource* resource() {
+        return &_pool;
+    }
+
+    /// \brief Returns the bytes a book with the given number of orders and
+    /// levels allocates, including the optional order timestamps.
+    static size_t bytes_for(size_t max_orders, size_t max_levels) {
+        size_t buckets = 16;
+        while (buckets < max_orders * 2) {
+            buckets <<= 1;
+        }
+        size_t bytes = buckets * 16
+                     + max_orders * (sizeof(order_record) + sizeof(uint32_t) + sizeof(uint64_t))
+                     + max_levels * per_level_bytes
+                     + 2 * 1024 * sizeof(level_pool::handle);
+        // Leave room for pool bookkeeping and partially used chunks.
+        return bytes + bytes / 4;
+    }
+
+private:
+    //! A level, its free list entry, its depth index entry with block slack,
+    //! and a far map node.
+    static constexpr size_t per_level_bytes = sizeof(price_level) + sizeof(level_pool::handle) + 2 * 16 + 64;
+
+    std::pmr::memory_resource* _upstream;
+    size_t _size;
+    void* _storage;
+    std::pmr::monotonic_buffer_resource _buffer;
+    std::pmr::unsynchronized_pool_resource _pool;
+};
+
+/// @}
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+/// \file order_table.hh
+///
+/// Flat hash table of live orders.
+
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace helix {
+
+/// \addtogroup order-book
+/// @{
+
+/// \brief Order table is an open addressing hash table of orders keyed by
+/// order id, side and book.
+///
+/// ITCH BIST order ids are only unique per order book and side (IDGYO.E
+/// sends the same id on both sides), so the side is part of the key. A table
+/// can be shared by the books of a book_engine, in which case the dense book
+/// index is part of the key as well; a table of a single book uses book 0.
+///
+/// Buckets are 16 bytes, hold the full key and are probed linearly, which
+/// keeps a lookup to the home cache line in the common case. Order records
+/// live in a slab that is preallocated from the expected number of orders
+/// and recycled through a free list, so inserts and erases do not allocate
+/// in steady state. A record keeps its slot while it is in the table, but
+/// pointers returned by find() are invalidated by an insert that grows the
+/// slab.
+///
+/// \tparam Order order record with an `id` member and a `side()` accessor.
+template<typename Order>
+class order_table {
+public:
+    using slot = uint32_t;
+    using side_type = decltype(std::declval<const Order&>().side());
+    static constexpr slot npos = ~slot{0};
+    //! Number of books a table can be shared by.
+    static constexpr uint32_t max_books = uint32_t{ 1 } << 24;
+
+    explicit order_table(size_t max_orders = 0,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _buckets{ resource }
+        , _slab{ resource }
+        , _free{ resource }
+    {
+        rehash(capacity_for(max_orders));
+        _slab.reserve(max_orders);
+        _free.reserve(max_orders);
+    }
+
+    void reserve(size_t max_orders) {
+        if (auto capacity = capacity_for(max_orders); capacity > _buckets.size()) {
+            rehash(capacity);
+        }
+        _slab.reserve(max_orders);
+        _free.reserve(max_orders);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    Order* find(uint64_t id, side_type side, uint32_t book = 0) {
+        auto i = probe(id, tag_of(side, book));
+        return _buckets[i].record == npos ? nullptr : &_slab[_buckets[i].record];
+    }
+
+    const Order* find(uint64_t id, side_type side, uint32_t book = 0) const {
+        auto i = probe(id, tag_of(side, book));
+        return _buckets[i].record == npos ? nullptr : &_slab[_buckets[i].record];
+    }
+
+    Order& at(slot s) {
+        return _slab[s];
+    }
+
+    const Order& at(slot s) const {
+        return _slab[s];
+    }
+
+    /// \brief Returns the slot of a record owned by the table.
+    slot slot_of(const Order& order) const {
+        return static_cast<slot>(&order - _slab.data());
+    }
+
+    /// \brief Inserts an order and returns its record, or nullptr if an
+    /// order with the same id and side is already in the book.
+    Order* insert(const Order& order, uint32_t book = 0) {
+        if ((_size + 1) * 2 > _buckets.size()) {
+            rehash(_buckets.size() * 2);
+        }
+        auto tag = tag_of(order.side(), book);
+        auto i = probe(order.id, tag);
+        if (_buckets[i].record != npos) {
+            return nullptr;
+        }
+        slot s;
+        if (!_free.empty()) {
+            s = _free.back();
+            _free.pop_back();
+            _slab[s] = order;
+        } else {
+            s = static_cast<slot>(_slab.size());
+            _slab.push_back(order);
+        }
+        _buckets[i] = bucket{ order.id, s, tag };
+        _size++;
+        return &_slab[s];
+    }
+
+    /// \brief Removes an order and returns false if there is none.
+    bool erase(uint64_t id, side_type side, uint32_t book = 0) {
+        auto i = probe(id, tag_of(side, book));
+        if (_buckets[i].record == npos) {
+            return false;
+        }
+        _free.push_back(_buckets[i].record);
+        // Backward shift deletion keeps probe sequences free of tombstones.
+        for (auto j = (i + 1) & _mask; _buckets[j].record != npos; j = (j + 1) & _mask) {
+            auto home = index_of(_buckets[j].id, _buckets[j].tag);
+            if (((j - home) & _mask) >= ((j - i) & _mask)) {
+                _buckets[i] = _buckets[j];
+                i = j;
+            }
+        }
+        _buckets[i].record = npos;
+        _size--;
+        return true;
+    }
+
+private:
+    struct bucket {
+        uint64_t id;
+        slot record{ npos };
+        //! Side in the low byte and book index above it.
+        uint32_t tag;
+    };
+    static_assert(sizeof(bucket) == 16, "order table bucket must be 16 bytes");
+
+    static size_t capacity_for(size_t max_orders) {
+        size_t capacity = 16;
+        while (capacity < max_orders * 2) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    static uint32_t tag_of(side_type side, uint32_t book) {
+        return static_cast<uint32_t>(side) | (book << 8);
+    }
+
+    size_t index_of(uint64_t id, uint32_t tag) const {
+        // Runs of 8 consecutive ids share two cache lines of buckets and the
+        // runs are spread with Fibonacci hashing, so the mostly sequential
+        // exchange ids keep their locality without clustering on strides.
+        // The side and book land in the high bits so that they change the
+        // run but not the position within it.
+        auto key = id ^ (static_cast<uint64_t>(tag) << 38);
+        auto run = ((key >> 3) * 0x9E3779B97F4A7C15ull) >> (_shift + 3);
+        return static_cast<size_t>((run << 3) | (key & 7));
+    }
+
+    /// Returns the bucket holding the key or the empty bucket ending its probe.
+    size_t probe(uint64_t id, uint32_t tag) const {
+        auto i = index_of(id, tag);
+        while (_buckets[i].record != npos &&
+               (_buckets[i].id != id || _buckets[i].tag != tag)) {
+            i = (i + 1) & _mask;
+        }
+        return i;
+    }
+
+    void rehash(size_t capacity) {
+        std::pmr::vector<bucket> old(capacity, _buckets.get_allocator());
+        old.swap(_buckets);
+        _mask = capacity - 1;
+        _shift = 64;
+        while (capacity > 1) {
+            capacity >>= 1;
+            _shift--;
+        }
+        for (auto&& b : old) {
+            if (b.record != npos) {
+                _buckets[probe(b.id, b.tag)] = b;
+            }
+        }
+    }
+
+    std::pmr::vector<bucket> _buckets;
+    size_t _mask{ 0 };
+    unsigned _shift{ 64 };
+    size_t _size{ 0 };
+    std::pmr::vector<Order> _slab;
+    std::pmr::vector<slot> _free;
+};
+
+/// @}
+
+}
@@ -40,6 +40,9 @@ public:
     bool is_rth_timestamp(uint64_t timestamp) const;
     void subscribe(std::string sym, size_t max_orders);
     void register_callback(event_callback callback);
+    //! PMD events are not emitted yet, so there is nothing to coalesce.
+    void set_coalescing(bool /*coalesce*/) {}
+    void flush_events() {}
     size_t process_packet(const net::packet_view& packet, bool sync);
 private:
     template<typename T>
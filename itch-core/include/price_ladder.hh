@@ -0,0 +1,521 @@
+#pragma once
+
+/// \file price_ladder.hh
+///
+/// Tick indexed storage for the price levels of one side of an order book.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+namespace helix {
+
+/// \addtogroup order-book
+/// @{
+
+/// \brief Price level is a time-prioritized list of orders with the same price.
+///
+/// The orders of a level form an intrusive doubly-linked queue threaded
+/// through the order records; head and tail are the order table slots of the
+/// first and last order in time priority.
+struct price_level {
+    static constexpr uint32_t npos = ~uint32_t{0};
+
+    explicit price_level(uint64_t price_ = 0)
+        : price(price_)
+        , size(0)
+    { }
+
+    uint64_t price;
+    uint64_t size;
+    //! Number of orders queued at the level.
+    uint32_t count{ 0 };
+    uint32_t head{ npos };
+    uint32_t tail{ npos };
+};
+
+/// \brief Pool of price levels shared by both sides of a book.
+///
+/// Levels are addressed by a 32-bit handle and never move once they are
+/// allocated, so orders can keep a pointer to their level while the ladder
+/// that indexes it re-anchors.
+class level_pool {
+public:
+    using handle = uint32_t;
+    static constexpr handle npos = ~handle{0};
+
+    explicit level_pool(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _levels{ resource }
+        , _free{ resource }
+    { }
+
+    void reserve(size_t max_levels) {
+        _free.reserve(max_levels);
+    }
+
+    handle allocate(uint64_t price) {
+        if (!_free.empty()) {
+            auto h = _free.back();
+            _free.pop_back();
+            _levels[h] = price_level{ price };
+            return h;
+        }
+        _levels.emplace_back(price);
+        return static_cast<handle>(_levels.size() - 1);
+    }
+
+    void release(handle h) {
+        _free.push_back(h);
+    }
+
+    price_level& operator[](handle h) {
+        return _levels[h];
+    }
+
+    const price_level& operator[](handle h) const {
+        return _levels[h];
+    }
+
+private:
+    std::pmr::deque<price_level> _levels;
+    std::pmr::vector<handle> _free;
+};
+
+/// \brief Depth index keeps the handles of the levels of one book side
+/// ordered from the worst to the best one.
+///
+/// The handles are stored in blocks of bounded size so that the best level
+/// sits at the back of the last block. Inserting or erasing a level moves at
+/// most two blocks. A block that drops below half of block_size after an
+/// erase is merged with a neighbour, so every block but a lone one holds at
+/// least block_size / 2 levels. Reading level n walks the blocks from the
+/// touch: a single indexed load for the levels in the top block and at most
+/// 2n / block_size + 1 steps for the others.
+///
+/// Every block also counts the orders queued at its levels, so the orders
+/// ahead of a level are summed per block rather than per level.
+class depth_index {
+public:
+    using handle = level_pool::handle;
+    static constexpr handle npos = level_pool::npos;
+
+    explicit depth_index(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _blocks{ resource }
+        , _block_orders{ resource }
+    { }
+
+    size_t size() const {
+        return _size;
+    }
+
+    /// \brief Returns the handle at depth n (0 is the best one) or npos.
+    handle nth(size_t n) const {
+        if (n >= _size) {
+            return npos;
+        }
+        for (auto b = _blocks.rbegin(); ; ++b) {
+            if (n < b->size()) {
+                return (*b)[b->size() - 1 - n].level;
+            }
+            n -= b->size();
+        }
+    }
+
+    /// \brief Inserts a level by its key, larger keys being worse. The level
+    /// must have no orders queued yet.
+    void insert(const level_pool& pool, uint64_t key, handle h) {
+        _size++;
+        if (_blocks.empty()) {
+            new_block().push_back(entry{ key, h });
+            return;
+        }
+        auto b = find_block(key);
+        if (b == _blocks.end()) {
+            --b;
+        }
+        b->insert(std::lower_bound(b->begin(), b->end(), key, worse), entry{ key, h });
+        if (b->size() > 2 * block_size) {
+            split(pool, b);
+        }
+    }
+
+    /// \brief Erases the level of key, which must have no orders queued.
+    void erase(const level_pool& pool, uint64_t key) {
+        auto b = find_block(key);
+        if (b == _blocks.end()) {
+            return;
+        }
+        auto it = std::lower_bound(b->begin(), b->end(), key, worse);
+        if (it == b->end() || it->key != key) {
+            return;
+        }
+        b->erase(it);
+        _size--;
+        if (b->size() >= block_size / 2) {
+            return;
+        }
+        if (_blocks.size() == 1) {
+            if (b->empty()) {
+                _blocks.clear();
+                _block_orders.clear();
+            }
+            return;
+        }
+        // Merge the block into a neighbour, splitting the result again if it
+        // is too large, so that blocks stay at least half full.
+        auto lower = b == _blocks.begin() ? b : b - 1;
+        auto upper = lower + 1;
+        auto l = static_cast<size_t>(lower - _blocks.begin());
+        lower->insert(lower->end(), upper->begin(), upper->end());
+        _block_orders[l] += _block_orders[l + 1];
+        _block_orders.erase(_block_orders.begin() + l + 1);
+        _blocks.erase(upper);
+        lower = _blocks.begin() + l;
+        if (lower->size() > 2 * block_size) {
+            split(pool, lower);
+        }
+    }
+
+    /// \brief Adds n, which may be negative, to the orders queued at the
+    /// level of key.
+    void count_orders(uint64_t key, int64_t n) {
+        auto b = find_block(key);
+        if (b != _blocks.end()) {
+            _block_orders[b - _blocks.begin()] += n;
+        }
+    }
+
+    /// \brief Returns the number of orders queued at the levels better than
+    /// key, walking at most one block.
+    uint64_t orders_ahead(const level_pool& pool, uint64_t key) const {
+        auto b = std::partition_point(_blocks.begin(), _blocks.end(),
+                                      [key](const block& b) { return b.back().key > key; });
+        uint64_t ahead = 0;
+        for (auto i = static_cast<size_t>(b - _blocks.begin()) + 1; i < _blocks.size(); i++) {
+            ahead += _block_orders[i];
+        }
+        if (b != _blocks.end()) {
+            for (auto it = std::upper_bound(b->begin(), b->end(), key, better); it != b->end(); ++it) {
+                ahead += pool[it->level].count;
+            }
+        }
+        return ahead;
+    }
+
+private:
+    struct entry {
+        uint64_t key;
+        handle level;
+    };
+    using block = std::pmr::vector<entry>;
+
+    static constexpr size_t block_size = 128;
+
+    static bool worse(const entry& e, uint64_t key) {
+        return e.key > key;
+    }
+
+    static bool better(uint64_t key, const entry& e) {
+        return e.key < key;
+    }
+
+    static uint64_t count(const level_pool& pool, const block& b) {
+        uint64_t orders = 0;
+        for (auto&& e : b) {
+            orders += pool[e.level].count;
+        }
+        return orders;
+    }
+
+    /// Splits a block in halves, keeping blocks in worst-first order.
+    void split(const level_pool& pool, std::pmr::vector<block>::iterator b) {
+        auto half = b->size() / 2;
+        auto upper = new_block(b + 1);
+        b = upper - 1;
+        upper->assign(b->begin() + half, b->end());
+        b->resize(half);
+        auto moved = count(pool, *upper);
+        _block_orders[upper - _blocks.begin()] = moved;
+        _block_orders[b - _blocks.begin()] -= moved;
+    }
+
+    /// Inserts an empty block before pos, with room for the entries it can
+    /// hold before it is split, after an insert or a merge.
+    std::pmr::vector<block>::iterator new_block(std::pmr::vector<block>::iterator pos) {
+        _block_orders.insert(_block_orders.begin() + (pos - _blocks.begin()), 0);
+        auto b = _blocks.emplace(pos);
+        b->reserve(2 * block_size + block_size / 2);
+        return b;
+    }
+
+    block& new_block() {
+        return *new_block(_blocks.end());
+    }
+
+    /// Returns the first block whose best key is not worse than key.
+    std::pmr::vector<block>::iterator find_block(uint64_t key) {
+        return std::partition_point(_blocks.begin(), _blocks.end(),
+                                    [key](const block& b) { return b.back().key > key; });
+    }
+
+    std::pmr::vector<block> _blocks;
+    //! Orders queued at the levels of each block.
+    std::pmr::vector<uint64_t> _block_orders;
+    size_t _size{ 0 };
+};
+
+/// \brief Read-only view over the levels of one book side, best level
+/// first; see depth_index for the cost of reading level n.
+class depth_view {
+public:
+    using handle = level_pool::handle;
+
+    depth_view(const level_pool& pool, const depth_index& index)
+        : _pool{ &pool }
+        , _index{ &index }
+    { }
+
+    size_t size() const {
+        return _index->size();
+    }
+
+    bool empty() const {
+        return _index->size() == 0;
+    }
+
+    /// \brief Returns the level at depth n (0 is the best one).
+    const price_level& operator[](size_t n) const {
+        return (*_pool)[_index->nth(n)];
+    }
+
+private:
+    const level_pool* _pool;
+    const depth_index* _index;
+};
+
+/// \brief Price ladder keeps the levels of one book side in a contiguous
+/// window indexed by the price offset from a moving anchor.
+///
+/// Prices are mapped to keys that grow away from the touch (ascending for
+/// asks, descending for bids) and the window is addressed as a ring, so
+/// finding, creating and erasing a level near the touch is a single indexed
+/// load. Levels worse than the window fall back to an ordered map. The
+/// window re-anchors whenever a new best price lands ahead of it or the window
+/// drains, which keeps the best level always inside the window.
+///
+/// Next to the window the ladder maintains a depth_index of all levels, so
+/// reading the levels near the touch is a single indexed load and deeper
+/// levels take a step per block.
+///
+/// The ladder only stores level handles; the levels themselves live in a
+/// level_pool owned by the book. The window is allocated when the first level
+/// is created, so a ladder of an instrument that never trades costs no more
+/// than its empty containers.
+template<typename Compare>
+class price_ladder {
+    static_assert(std::is_same_v<Compare, std::less<uint64_t>> ||
+                  std::is_same_v<Compare, std::greater<uint64_t>>,
+                  "price ladder is ordered either by std::less or std::greater");
+
+    static constexpr bool ascending = std::is_same_v<Compare, std::less<uint64_t>>;
+public:
+    using handle = level_pool::handle;
+    static constexpr handle npos = level_pool::npos;
+
+    /// \param resource memory resource for the window, the far levels and the
+    ///        depth index.
+    /// \param window number of ticks kept in the contiguous window, rounded
+    ///        up to a power of two.
+    explicit price_ladder(std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                          size_t window = 1024)
+        : _slots{ resource }
+        , _far{ resource }
+        , _depth{ resource }
+    {
+        size_t n = 1;
+        while (n < window) {
+            n <<= 1;
+        }
+        _mask = n - 1;
+    }
+
+    size_t size() const {
+        return _depth.size();
+    }
+
+    bool empty() const {
+        return _depth.size() == 0;
+    }
+
+    /// \brief Returns the handle of the level at price or npos.
+    handle find(uint64_t price) const {
+        if (_slots.empty()) {
+            return npos;
+        }
+        auto k = key(price);
+        if (in_window(k)) {
+            return _slots[k & _mask];
+        }
+        auto it = _far.find(price);
+        return it == _far.end() ? npos : it->second;
+    }
+
+    handle lookup_or_create(level_pool& pool, uint64_t price) {
+        if (_slots.empty()) {
+            _slots.assign(_mask + 1, npos);
+        }
+        auto k = key(price);
+        if (!in_window(k)) {
+            if (_window_count == 0 || k < _base) {
+                // The new price becomes the best one, move the window to it.
+                reanchor(k);
+            } else {
+                auto it = _far.find(price);
+                if (it == _far.end()) {
+                    it = _far.emplace(price, pool.allocate(price)).first;
+                    _depth.insert(pool, k, it->second);
+                }
+                return it->second;
+            }
+        }
+        auto& h = _slots[k & _mask];
+        if (h == npos) {
+            h = pool.allocate(price);
+            _window_count++;
+            _depth.insert(pool, k, h);
+        }
+        return h;
+    }
+
+    /// \brief Removes the level at price and returns false if there is none.
+    bool erase(level_pool& pool, uint64_t price) {
+        if (_slots.empty()) {
+            return false;
+        }
+        auto k = key(price);
+        if (!in_window(k)) {
+            auto it = _far.find(price);
+            if (it == _far.end()) {
+                return false;
+            }
+            pool.release(it->second);
+            _far.erase(it);
+            _depth.erase(pool, k);
+            return true;
+        }
+        auto& h = _slots[k & _mask];
+        if (h == npos) {
+            return false;
+        }
+        pool.release(h);
+        h = npos;
+        _depth.erase(pool, k);
+        if (--_window_count == 0 && !_far.empty()) {
+            reanchor(key(_far.begin()->first));
+        }
+        return true;
+    }
+
+    /// \brief Returns the handle of the level at depth n (0 is the best one)
+    /// or npos.
+    handle nth(size_t n) const {
+        return _depth.nth(n);
+    }
+
+    depth_view depth(const level_pool& pool) const {
+        return depth_view{ pool, _depth };
+    }
+
+    /// \brief Adds n, which may be negative, to the orders counted at the
+    /// level at price; the book calls it whenever it queues or dequeues an
+    /// order.
+    void count_orders(uint64_t price, int64_t n) {
+        _depth.count_orders(key(price), n);
+    }
+
+    /// \brief Returns the number of orders queued at the levels better than
+    /// price.
+    uint64_t orders_ahead(const level_pool& pool, uint64_t price) const {
+        return _depth.orders_ahead(pool, key(price));
+    }
+
+    /// \brief Removes every level, returning them to the pool, and frees the
+    /// window.
+    void clear(level_pool& pool) {
+        for (auto h : _slots) {
+            if (h != npos) {
+                pool.release(h);
+            }
+        }
+        for (auto&& [price, h] : _far) {
+            pool.release(h);
+        }
+        auto* resource = _slots.get_allocator().resource();
+        std::pmr::vector<handle>{ resource }.swap(_slots);
+        _far.clear();
+        _depth = depth_index{ resource };
+        _base = 0;
+        _window_count = 0;
+    }
+
+private:
+    static uint64_t key(uint64_t price) {
+        if constexpr (ascending) {
+            return price;
+        } else {
+            return ~price;
+        }
+    }
+
+    static uint64_t price_of(uint64_t k) {
+        return key(k);
+    }
+
+    bool in_window(uint64_t k) const {
+        return k - _base <= _mask;
+    }
+
+    /// Moves the window so that key k sits a few ticks after its start,
+    /// spilling levels that fall out of it to the far map and pulling far
+    /// levels that fall in.
+    void reanchor(uint64_t k) {
+        const uint64_t margin = (_mask + 1) / 8;
+        const uint64_t base = k > margin ? k - margin : 0;
+        if (_window_count) {
+            for (size_t slot = 0; slot <= _mask; slot++) {
+                if (_slots[slot] == npos) {
+                    continue;
+                }
+                auto old_key = _base + ((slot - _base) & _mask);
+                if (old_key - base > _mask) {
+                    _far.emplace(price_of(old_key), _slots[slot]);
+                    _slots[slot] = npos;
+                    _window_count--;
+                }
+            }
+        }
+        _base = base;
+        for (auto it = _far.begin(); it != _far.end() && in_window(key(it->first)); ) {
+            _slots[key(it->first) & _mask] = it->second;
+            _window_count++;
+            it = _far.erase(it);
+        }
+    }
+
+    uint64_t _mask{ 0 };
+    uint64_t _base{ 0 };
+    size_t _window_count{ 0 };
+    std::pmr::vector<handle> _slots;
+    std::pmr::map<uint64_t, handle, Compare> _far;
+    depth_index _depth;
+};
+
+/// @}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/// \file seqlock.hh
+///
+/// Sequence lock for publishing plain values to reader threads.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace helix {
+
+/// \brief Sequence lock holds a plain value that one thread stores and any
+/// number of threads load.
+///
+/// The writer never waits for readers, and a reader that overlaps a store
+/// retries. The value is kept as atomic words, so a torn copy is detected
+/// rather than being a data race. The lock starts on a cache line of its
+/// own, which a value of up to seven words shares with the sequence.
+template<typename T>
+class alignas(64) seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "only plain values can be published");
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0, "value must be made of whole words");
+    static constexpr size_t words = sizeof(T) / sizeof(uint64_t);
+public:
+    seqlock() = default;
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    /// \brief Publishes a value. Only one thread may store.
+    void store(const T& value) {
+        uint64_t w[words];
+        std::memcpy(w, &value, sizeof(value));
+        auto sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < words; i++) {
+            _words[i].store(w[i], std::memory_order_relaxed);
+        }
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// \brief Copies the latest value to out and returns true, or returns
+    /// false if a store was in progress.
+    bool try_load(T& out) const {
+        auto before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        uint64_t w[words];
+        for (size_t i = 0; i < words; i++) {
+            w[i] = _words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, w, sizeof(out));
+        return true;
+    }
+
+    /// \brief Returns the latest value, retrying while a store is in
+    /// progress. A value that was never stored reads as all zero bits.
+    T load() const {
+        T value;
+        while (!try_load(value)) {
+        }
+        return value;
+    }
+
+    //! Number of values stored so far.
+    uint64_t version() const {
+        return _sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    //! Odd while a store is in progress.
+    std::atomic<uint64_t> _sequence{ 0 };
+    std::atomic<uint64_t> _words[words]{};
+};
+
+}
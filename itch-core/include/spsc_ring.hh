@@ -0,0 +1,194 @@
+#pragma once
+
+/// \file spsc_ring.hh
+///
+/// Bounded ring for handing plain values from one thread to another.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace helix {
+
+/// \brief Single producer single consumer ring holds up to Capacity plain
+/// values in a fixed array.
+///
+/// One thread pushes and one thread consumes, neither takes a lock nor
+/// allocates. Each side keeps its index on a cache line of its own, with a
+/// cached copy of the other side's index so that a full batch costs one
+/// shared load rather than one per value.
+template<typename T, size_t Capacity>
+class spsc_ring {
+    static_assert(std::is_trivially_copyable_v<T>, "only plain values can be queued");
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static constexpr size_t mask = Capacity - 1;
+public:
+    spsc_ring() = default;
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    /// \brief Queues a value and returns true, or returns false if the ring
+    /// is full. Only the producer may push.
+    bool try_push(const T& value) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cached_head == Capacity) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail - _cached_head == Capacity) {
+                return false;
+            }
+        }
+        new (&_slots[tail & mask].value) T(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// \brief Queues as many of count values as fit and returns how many it
+    /// queued. The consumer sees them all at once.
+    size_t try_push(const T* values, size_t count) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (Capacity - (tail - _cached_head) < count) {
+            _cached_head = _head.load(std::memory_order_acquire);
+        }
+        size_t room = Capacity - (tail - _cached_head);
+        if (count > room) {
+            count = room;
+        }
+        for (size_t i = 0; i < count; i++) {
+            new (&_slots[(tail + i) & mask].value) T(values[i]);
+        }
+        if (count) {
+            _tail.store(tail + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// \brief Passes up to max queued values to fun in order and returns
+    /// how many it passed. Only the consumer may consume.
+    template<typename Function>
+    size_t consume(Function&& fun, size_t max = Capacity) {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (_cached_tail == head) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+        }
+        size_t count = _cached_tail - head;
+        if (count > max) {
+            count = max;
+        }
+        for (size_t i = 0; i < count; i++) {
+            fun(static_cast<const T&>(_slots[(head + i) & mask].value));
+        }
+        if (count) {
+            _head.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// \brief Returns true if nothing is queued. Exact only on the consumer.
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    /// \brief Returns true if no value can be pushed. Exact only on the
+    /// producer.
+    bool full() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire) == Capacity;
+    }
+
+private:
+    //! Storage of a value, which needs no default constructor.
+    union slot {
+        slot() {}
+        T value;
+    };
+
+    //! Next value to consume, written by the consumer.
+    alignas(64) std::atomic<size_t> _head{ 0 };
+    size_t _cached_tail{ 0 };
+    //! Next slot to push to, written by the producer.
+    alignas(64) std::atomic<size_t> _tail{ 0 };
+    size_t _cached_head{ 0 };
+    alignas(64) slot _slots[Capacity];
+};
+
+/// \brief Drain flag tells the producer of a ring whether the consumer has
+/// a drain scheduled, so that only the first value of a batch schedules one.
+///
+/// The producer pushes and then claims the flag, the consumer releases the
+/// flag and then checks the ring for values pushed meanwhile. Each side
+/// stores and then loads what the other side stores, so both fence in
+/// between; otherwise each could read the other's stale state and a value
+/// would wait in the ring with no drain scheduled.
+class drain_flag {
+    std::atomic<bool> _scheduled{ false };
+public:
+    /// \brief Returns true if the caller, which just pushed, must schedule a
+    /// drain.
+    bool try_claim() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return !_scheduled.load(std::memory_order_relaxed) && !_scheduled.exchange(true);
+    }
+
+    /// \brief Marks the drain as done. The consumer then checks the ring and
+    /// calls try_claim() if it is not empty.
+    void release() {
+        _scheduled.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    bool scheduled() const {
+        return _scheduled.load();
+    }
+};
+
+/// \brief Parking spot lets a thread that waits for the other side of a
+/// ring spin for a while and then sleep until the other side wakes it.
+///
+/// The waiter marks itself parked and then checks its condition, the other
+/// side makes the condition true and then checks the mark, each with a fence
+/// in between, so that a wake-up is never lost.
+class parking_spot {
+    std::atomic<bool> _parked{ false };
+    std::mutex _mutex;
+    std::condition_variable _cv;
+public:
+    /// \brief Returns once ready() returns true, yielding for spin_time and
+    /// then parking. Only one thread may wait.
+    template<typename Ready>
+    void wait(Ready&& ready, std::chrono::nanoseconds spin_time) {
+        auto spin_until = std::chrono::steady_clock::now() + spin_time;
+        while (!ready()) {
+            if (std::chrono::steady_clock::now() < spin_until) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            _cv.wait(lock, ready);
+            _parked.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    /// \brief Wakes the waiting thread if it parked. Called after whatever
+    /// the waiter checks in ready() changed.
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_parked.load(std::memory_order_relaxed)) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+            }
+            _cv.notify_one();
+        }
+    }
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/// \file thread_topology.hh
+///
+/// Placing feed and algo threads on CPUs and NUMA nodes.
+
+#include <boost/asio/thread_pool.hpp>
+
+#include <cstddef>
+#include <istream>
+#include <vector>
+
+namespace helix {
+
+/// \brief Thread placement names the CPU a thread runs on and the NUMA node
+/// its memory comes from.
+struct thread_placement {
+    //! CPU to pin the thread to, or -1 to leave it unpinned.
+    int cpu{ -1 };
+    //! NUMA node to allocate from, or -1 for the node of cpu.
+    int numa_node{ -1 };
+
+    bool pinned() const {
+        return cpu >= 0 || numa_node >= 0;
+    }
+};
+
+/// \brief Thread topology places the threads of a feed: the thread that
+/// processes packets and the threads that run algos.
+///
+/// A topology is read from lines of the form `<role> <cpu> [<node>]`, where
+/// role is feed or algo, and `#` starts a comment. Algo lines are
+/// taken in order, either by algos with a thread each or by the workers of
+/// an algo scheduler:
+///
+///     feed 2 0
+///     algo 3 0
+///     algo 4 0
+struct thread_topology {
+    thread_placement feed;
+    std::vector<thread_placement> algos;
+
+    /// \brief Returns the placement of the index-th algo thread, which is
+    /// unpinned past the configured ones.
+    thread_placement algo(size_t index) const {
+        return index < algos.size() ? algos[index] : thread_placement{};
+    }
+
+    static thread_topology parse(std::istream& in);
+};
+
+/// \brief Pins the calling thread to the CPU of a placement and makes the
+/// memory it allocates from now on come from the placement's node.
+///
+/// Does nothing for an unpinned placement and throws std::system_error if
+/// the operating system refuses the placement.
+void pin_current_thread(const thread_placement& placement);
+
+/// \brief Pins the thread of a single thread pool, waiting until it is
+/// pinned so that everything posted afterwards runs in place.
+void pin_thread_pool(boost::asio::thread_pool& pool, const thread_placement& placement);
+
+/// \brief Returns the CPUs the calling thread may run on.
+std::vector<int> current_thread_cpus();
+
+/// \brief Returns the NUMA node of the CPU the calling thread runs on.
+int current_numa_node();
+
+/// \brief Returns the node the calling thread prefers to allocate from, or
+/// -1 if it follows the default policy. It is read back with
+/// get_mempolicy(); /proc/self/status does not show a preferred node.
+int current_memory_node();
+
+/// \brief Returns the id the OS knows the calling thread by, the <tid> of
+/// /proc/self/task/<tid>/status on Linux.
+long current_thread_id();
+
+}
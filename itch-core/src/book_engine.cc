@@ -0,0 +1,79 @@
+#include "book_engine.hh"
+
+#include <stdexcept>
+
+namespace helix {
+
+  book_engine::book_engine(size_t max_orders, std::pmr::memory_resource* resource)
+    : _resource{ resource }
+    , _max_orders{ max_orders }
+    , _orders(max_orders, resource)
+    , _levels(resource)
+    , _order_timestamps(resource)
+    , _books_by_id(resource)
+    , _order_book_ids(resource)
+    , _symbols(resource)
+    , _state_names(resource)
+    , _timestamps(resource)
+    , _states(resource)
+    , _num_decimals_for_price(resource)
+    , _book_max_orders(resource)
+    , _order_counts(resource)
+    , _keep_order_timestamps(resource)
+    , _bbo_versions(resource)
+    , _bids(resource)
+    , _asks(resource)
+  { }
+
+  book_engine::book_index book_engine::add_book(uint32_t order_book_id,
+                                                std::string symbol,
+                                                uint64_t timestamp,
+                                                uint16_t num_decimals_for_price,
+                                                size_t max_orders)
+  {
+    if (book_count() >= order_set::max_books) {
+      throw std::length_error("too many order books");
+    }
+    auto book = static_cast<book_index>(book_count());
+    _order_book_ids.push_back(order_book_id);
+    _symbols.emplace_back(symbol);
+    _state_names.emplace_back();
+    _timestamps.push_back(timestamp);
+    _states.push_back(trading_state::unknown);
+    _num_decimals_for_price.push_back(num_decimals_for_price);
+    _book_max_orders.push_back(max_orders);
+    _order_counts.push_back(0);
+    _keep_order_timestamps.push_back(0);
+    _bbo_versions.push_back(0);
+    _bids.emplace_back(_resource);
+    _asks.emplace_back(_resource);
+    _books_by_id[order_book_id] = book;
+    if (max_orders) {
+      _max_orders += max_orders;
+      _orders.reserve(_max_orders);
+    }
+    return book;
+  }
+
+  void book_engine::clear_book(book_index book)
+  {
+    auto clear_side = [this, book](auto& ladder) {
+      auto depth = ladder.depth(_levels);
+      for (size_t i = 0; i < depth.size(); i++) {
+        for (auto s = depth[i].head; s != price_level::npos;) {
+          const auto& o = _orders.at(s);
+          s = o.next;
+          _orders.erase(o.id, o.side(), book);
+        }
+      }
+      ladder.clear(_levels);
+    };
+    clear_side(_bids[book]);
+    clear_side(_asks[book]);
+    _order_counts[book] = 0;
+    _bbo_versions[book]++;
+    _max_orders -= _book_max_orders[book];
+    _book_max_orders[book] = 0;
+  }
+
+}
@@ -0,0 +1,25 @@
+#include "book_snapshot.hh"
+
+namespace helix {
+
+  void book_publisher::publish(const order_book& ob)
+  {
+    book_snapshot s;
+    s.timestamp = ob.timestamp();
+    s.bbo_version = ob.bbo_version();
+    s.order_count = ob.order_count();
+    s.decimals_for_price = ob.decimals_for_price();
+    auto bids = ob.bid_depth();
+    auto asks = ob.ask_depth();
+    s.bid_levels = bids.size();
+    s.ask_levels = asks.size();
+    for (size_t i = 0; i < book_snapshot::depth && i < bids.size(); i++) {
+      s.bids[i] = book_snapshot::level{ bids[i].price, bids[i].size, bids[i].count };
+    }
+    for (size_t i = 0; i < book_snapshot::depth && i < asks.size(); i++) {
+      s.asks[i] = book_snapshot::level{ asks[i].price, asks[i].size, asks[i].count };
+    }
+    _snapshot.store(s);
+  }
+
+}
@@ -1,12 +1,18 @@
 #include "helix.hh"
 
+#include <memory_resource>
+#include <mutex>
+#include <unordered_set>
+
 namespace helix {
 
 event::event(event_mask mask, 
-             std::string symbol,
+             std::string_view symbol,
              uint64_t timestamp, 
-             trade&& t)
+             trade&& t,
+             uint32_t instrument)
   : _mask{mask}
+  , _instrument{ instrument }
   , _symbol{ symbol }
   , _timestamp{ timestamp }
   , _trade{ std::move(t) }
@@ -18,11 +24,16 @@ event_mask event::get_mask() const
     return _mask;
 }
 
-std::string event::get_symbol() const
+std::string_view event::get_symbol() const
 {
     return _symbol;
 }
 
+uint32_t event::get_instrument() const
+{
+    return _instrument;
+}
+
 uint64_t event::get_timestamp() const
 {
     return _timestamp;
@@ -33,23 +44,50 @@ trade* event::get_trade() const
   return const_cast<trade*>(&_trade);
 }
 
-std::shared_ptr<event> make_event(std::string symbol, uint64_t timestamp, trade&& t, event_mask mask)
+const best_bid_offer& event::get_bbo() const
+{
+  return _bbo;
+}
+
+void event::set_bbo(const best_bid_offer& bbo)
+{
+  _bbo = bbo;
+}
+
+std::string_view intern_symbol(std::string_view symbol)
+{
+  // Set nodes never move, so the interned strings stay where they are.
+  static std::mutex guard;
+  static std::unordered_set<std::string> symbols;
+  std::scoped_lock lock(guard);
+  return *symbols.emplace(symbol).first;
+}
+
+std::shared_ptr<event> make_shared_event(const event& ev)
+{
+  // Consumers may drop their references on other threads, so the pool is
+  // synchronized. It lives as long as the process, like the events it serves.
+  static std::pmr::synchronized_pool_resource* pool = new std::pmr::synchronized_pool_resource();
+  return std::allocate_shared<event>(std::pmr::polymorphic_allocator<event>{ pool }, ev);
+}
+
+std::shared_ptr<event> make_event(std::string_view symbol, uint64_t timestamp, trade&& t, event_mask mask)
 {
-  return std::make_shared<event>(mask | ev_order_book_update | ev_trade, symbol, timestamp, std::move(t));
+  return make_shared_event(event{ mask | ev_order_book_update | ev_trade, intern_symbol(symbol), timestamp, std::move(t) });
 }
 std::shared_ptr<event> make_sys_event(uint64_t timestamp, event_mask mask)
 {
-  return std::make_shared<event>(mask, "", timestamp, trade{});
+  return make_shared_event(event{ mask, "", timestamp, trade{} });
 }
 
-std::shared_ptr<event> make_ob_event(std::string symbol, uint64_t timestamp, event_mask mask)
+std::shared_ptr<event> make_ob_event(std::string_view symbol, uint64_t timestamp, event_mask mask)
 {
-  return std::make_shared<event>(mask | ev_order_book_update, symbol, timestamp, trade {});
+  return make_shared_event(event{ mask | ev_order_book_update, intern_symbol(symbol), timestamp, trade {} });
 }
 
-std::shared_ptr<event> make_trade_event(std::string symbol, uint64_t timestamp, trade&& t, event_mask mask)
+std::shared_ptr<event> make_trade_event(std::string_view symbol, uint64_t timestamp, trade&& t, event_mask mask)
 {
-  return std::make_shared<event>(mask | ev_trade, symbol, timestamp, std::move(t));
+  return make_shared_event(event{ mask | ev_trade, intern_symbol(symbol), timestamp, std::move(t) });
 }
 
 }
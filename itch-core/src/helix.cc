@@ -1,6 +1,7 @@
 #include "extern-c/helix.h"
 
 #include "compat/endian.h"
+#include "book_snapshot.hh"
 #include "nasdaq/itch_bist_protocol.hh"
 #include "net.hh"
 #include <vector>
@@ -56,6 +57,16 @@ inline helix::session* unwrap(helix_session_t session)
   return reinterpret_cast<helix::session*>(session);
 }
 
+inline helix_top_of_book_t wrap(const helix::top_of_book_publisher* top)
+{
+  return reinterpret_cast<helix_top_of_book_t>(const_cast<helix::top_of_book_publisher*>(top));
+}
+
+inline const helix::top_of_book_publisher* unwrap(helix_top_of_book_t top)
+{
+  return reinterpret_cast<const helix::top_of_book_publisher*>(top);
+}
+
 const char* helix_strerror(int error)
 {
   switch (error) {
@@ -83,8 +94,8 @@ helix_session_t
 helix_session_create(helix_protocol_t proto, helix_event_callback_t callback, void* data)
 {
   auto session = unwrap(proto)->new_session(data);
-  session->register_callback([session, callback](std::shared_ptr<helix::event> event) {
-    callback(wrap(session), wrap(event.get()));
+  session->register_event_callback([session, callback](const helix::event& event) {
+    callback(wrap(session), wrap(const_cast<helix::event*>(&event)));
                              });
   return wrap(session);
 }
@@ -106,6 +117,23 @@ void helix_session_set_send_callback(helix_session_t session, helix_send_callbac
                                      });
 }
 
+helix_top_of_book_t helix_session_top_of_book(helix_session_t session, const char* symbol, size_t max_orders)
+{
+  return wrap(unwrap(session)->share_top_of_book(symbol, max_orders));
+}
+
+void helix_top_of_book_read(helix_top_of_book_t top, helix_quote_t* quote)
+{
+  auto t = unwrap(top)->load();
+  quote->timestamp = t.timestamp;
+  quote->bid_price = t.bid_price;
+  quote->bid_size = t.bid_size;
+  quote->ask_price = t.ask_price;
+  quote->ask_size = t.ask_size;
+  quote->last_price = t.last_price;
+  quote->last_size = t.last_size;
+}
+
 void* helix_session_data(helix_session_t session)
 {
   return unwrap(session)->data();
@@ -133,6 +161,16 @@ size_t helix_session_process_packet(helix_session_t session, const char* buf, si
     return HELIX_ERROR_UNKNOWN;
   }
 }
+
+void helix_session_flush(helix_session_t session)
+{
+  unwrap(session)->flush();
+}
+
+void helix_session_set_coalescing(helix_session_t session, bool coalesce)
+{
+  unwrap(session)->set_coalescing(coalesce);
+}
 /*
 bool helix::session::check_is_working_time(uint64_t timestamp) {
   auto fut = post(_pool, use_future(
@@ -215,6 +253,15 @@ helix_trade_t helix_event_trade(helix_event_t ev)
   return wrap(unwrap(ev)->get_trade());
 }
 
+void helix_event_bbo(helix_event_t ev, helix_bbo_t* bbo)
+{
+  const auto& b = unwrap(ev)->get_bbo();
+  bbo->bid_price = b.bid_price;
+  bbo->bid_size = b.bid_size;
+  bbo->ask_price = b.ask_price;
+  bbo->ask_size = b.ask_size;
+}
+
 helix_timestamp_t helix_order_book_timestamp(helix_order_book_t ob)
 {
   return unwrap(ob)->timestamp();
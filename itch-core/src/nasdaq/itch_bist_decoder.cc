@@ -0,0 +1,56 @@
+#include "nasdaq/itch_bist_decoder.hh"
+
+#include "helix.hh"
+
+#include <string>
+
+namespace helix {
+
+namespace nasdaq {
+
+template<typename T>
+static size_t decode(const char* buf, size_t len, itch_bist_decoded<T>& out)
+{
+  if (len < sizeof(T)) {
+    throw truncated_packet_error("truncated message: " + std::string(1, buf[0]));
+  }
+  out = itch_bist_decoded<T>::decode(buf);
+  return sizeof(T);
+}
+
+size_t itch_bist_decode(const char* buf, size_t len, itch_bist_decoded_message& out)
+{
+  out.MessageType = buf[0];
+  switch (out.MessageType) {
+  case 'T': return decode(buf, len, out.seconds);
+  case 'R': return decode(buf, len, out.order_book_directory);
+  case 'M': return decode(buf, len, out.combination_order_book_leg);
+  case 'L': return decode(buf, len, out.tick_size_table_entry);
+  case 'S': return decode(buf, len, out.system_event);
+  case 'O': return decode(buf, len, out.order_book_state);
+  case 'A': return decode(buf, len, out.add_order);
+  case 'F': return decode(buf, len, out.add_order_mpid);
+  case 'E': return decode(buf, len, out.order_executed);
+  case 'C': return decode(buf, len, out.order_executed_with_price);
+  case 'U': return decode(buf, len, out.order_replace);
+  case 'D': return decode(buf, len, out.order_delete);
+  case 'P': return decode(buf, len, out.trade);
+  case 'Z': return decode(buf, len, out.equilibrium_price_update);
+  default: throw unknown_message_type("unknown type: " + std::string(1, out.MessageType));
+  }
+}
+
+size_t itch_bist_decode_payload(const net::packet_view& payload, std::vector<itch_bist_decoded_message>& out)
+{
+  size_t count = 0;
+  for (auto* p = payload.buf(); p < payload.end(); count++) {
+    itch_bist_decoded_message m;
+    p += itch_bist_decode(p, payload.end() - p, m);
+    out.push_back(m);
+  }
+  return count;
+}
+
+}
+
+}
@@ -1,5 +1,6 @@
 #include "nasdaq/itch_bist_protocol.hh"
 #include "nasdaq/itch_bist_handler.hh"
+#include "nasdaq/itch_bist_sharded_handler.hh"
 #include "nasdaq/binaryfile.hh"
 
 namespace helix {
@@ -8,7 +9,8 @@ namespace nasdaq {
 
 bool itch_bist_protocol::supports(const std::string& name)
 {
-    return name == "nasdaq-binaryfile-itch-bist";
+    return name == "nasdaq-binaryfile-itch-bist"
+        || name == "nasdaq-binaryfile-itch-bist-sharded";
 }
 
 itch_bist_protocol::itch_bist_protocol(std::string name)
@@ -19,7 +21,9 @@ itch_bist_protocol::itch_bist_protocol(std::string name)
 session* itch_bist_protocol::new_session(void *data)
 {
     if (_name == "nasdaq-binaryfile-itch-bist") {
-        return new binaryfile_session<itch_bist_handler>(data);
+        return new binaryfile_session<itch_bist_handler<>>(data);
+    } else if (_name == "nasdaq-binaryfile-itch-bist-sharded") {
+        return new binaryfile_session<itch_bist_sharded_handler<>>(data);
     } else {
         throw std::invalid_argument("unknown protocol: " + _name);
     }
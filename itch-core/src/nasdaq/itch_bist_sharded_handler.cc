@@ -0,0 +1,11 @@
+#include "nasdaq/itch_bist_sharded_handler.hh"
+
+namespace helix {
+
+namespace nasdaq {
+
+template class itch_bist_sharded_handler<callback_listener>;
+
+}
+
+}
@@ -1,6 +1,5 @@
 #include "order_book.hh"
 
-#include <boost/version.hpp>
 #include <stdexcept>
 #include <limits>
 #include <mutex>
@@ -16,86 +15,269 @@ namespace helix {
     , is_valid{ true }
   { }
 
-  order_book::order_book(std::string symbol, uint64_t timestamp, size_t max_orders)
-    : order_book(symbol, timestamp, 0, max_orders) { }
+  order_book::order_book(std::string symbol,
+                         uint64_t timestamp,
+                         size_t max_orders,
+                         std::pmr::memory_resource* resource)
+    : order_book(symbol, timestamp, 0, max_orders, resource) { }
 
   order_book::order_book(std::string symbol,
                          uint64_t timestamp,
                          uint16_t num_decimals_for_price,
-                         size_t max_orders)
-    : _symbol{ std::move(symbol) }
-    , _timestamp{ timestamp }
-    , _state{ trading_state::unknown }
-    , _num_decimals_for_price(num_decimals_for_price)
-    , _max_orders(max_orders)
+                         size_t max_orders,
+                         std::pmr::memory_resource* resource)
+    : _owned_engine{ std::make_unique<book_engine>(0, resource) }
+    , _engine{ _owned_engine.get() }
+    , _book{ _engine->add_book(0, std::move(symbol), timestamp, num_decimals_for_price, max_orders) }
+  { }
+
+  order_book::order_book(book_engine& engine, book_engine::book_index book)
+    : _engine{ &engine }
+    , _book{ book }
+  { }
+
+  void order_book::add(order order, uint32_t position)
   {
-    _orders.reserve(max_orders);
+    //std::scoped_lock lock(guard);
+    if (order.side != side_type::buy && order.side != side_type::sell) {
+      throw std::invalid_argument(std::string("invalid side: ") + static_cast<char>(order.side));
+    }
+    if (order.price > std::numeric_limits<uint32_t>::max()) {
+      throw std::invalid_argument(std::string("invalid price: ") + std::to_string(order.price));
+    }
+    auto* o = _engine->_orders.insert(order_record{ order }, _book);
+    if (!o) {
+      fmt::print("\norder_book::add()::duplicate order id: {} with symbol: {}", order.id, this->symbol());
+      return;
+    }
+    _engine->_order_counts[_book]++;
+    auto h = order.side == side_type::buy ? lookup_or_create(bids(), o->price)
+                                          : lookup_or_create(asks(), o->price);
+    o->set_level(h);
+    _engine->_levels[h].size += o->quantity;
+    enqueue(*o, position);
+    note_level_change(*o);
+    if (_engine->_keep_order_timestamps[_book]) {
+      stamp(*o, order.timestamp);
+    }
   }
 
-  void order_book::add(order order)
+  void order_book::replace(uint64_t order_id, order order, uint32_t position)
   {
-    //std::scoped_lock lock(guard);
-    switch (order.side) {
-    case side_type::buy: {
-      auto&& level = lookup_or_create(_bids, order.price);
-      order.level = &level;
-      level.size += order.quantity;
-      break;
+    remove(order_id, order.side);
+    add(std::move(order), position);
+  }
+
+  void order_book::modify(uint64_t order_id, side_type side, uint64_t price, uint64_t quantity,
+                          uint64_t timestamp, uint32_t position)
+  {
+    if (price > std::numeric_limits<uint32_t>::max()) {
+      throw std::invalid_argument(std::string("invalid price: ") + std::to_string(price));
     }
-    case side_type::sell: {
-      auto&& level = lookup_or_create(_asks, order.price);
-      order.level = &level;
-      level.size += order.quantity;
-      break;
+    auto* o = _engine->_orders.find(order_id, side, _book);
+    if (!o) {
+      fmt::print("\norder_book::modify()::order id: {} with symbol: {}", order_id, this->symbol());
+      return;
     }
-    default:
-    throw std::invalid_argument(std::string("invalid side: ") + static_cast<char>(order.side));
+    modify_impl(*o, price, quantity, timestamp, position);
+  }
+
+  void order_book::modify_impl(order_record& o, uint64_t price, uint64_t quantity, uint64_t timestamp,
+                               uint32_t position)
+  {
+    auto&& level = _engine->_levels[o.level()];
+    if (o.price == price) {
+      level.size = level.size - o.quantity + quantity;
+      o.quantity = quantity;
+      if (position) {
+        dequeue(o);
+        enqueue(o, position);
+      }
+      note_level_change(o);
+    } else {
+      note_level_change(o);
+      level.size -= o.quantity;
+      dequeue(o);
+      if (level.count == 0) {
+        if (o.side() == side_type::buy) {
+          bids().erase(_engine->_levels, o.price);
+        } else {
+          asks().erase(_engine->_levels, o.price);
+        }
+      }
+      auto h = o.side() == side_type::buy ? lookup_or_create(bids(), price)
+                                          : lookup_or_create(asks(), price);
+      o.price = static_cast<uint32_t>(price);
+      o.quantity = quantity;
+      o.set_level(h);
+      _engine->_levels[h].size += quantity;
+      enqueue(o, position);
+      note_level_change(o);
+    }
+    if (_engine->_keep_order_timestamps[_book]) {
+      stamp(o, timestamp);
     }
-    _orders.emplace(std::move(order));
   }
 
-  void order_book::replace(uint64_t order_id, order order)
+  void order_book::note_level_change(const order_record& o)
   {
-    remove(order_id);
-    add(std::move(order));
+    auto best = o.side() == side_type::buy ? bids().nth(0) : asks().nth(0);
+    if (best == o.level()) {
+      _engine->_bbo_versions[_book]++;
+    }
+  }
+
+  void order_book::stamp(const order_record& o, uint64_t timestamp)
+  {
+    auto slot = _engine->_orders.slot_of(o);
+    if (slot >= _engine->_order_timestamps.size()) {
+      _engine->_order_timestamps.resize(std::max<size_t>(slot + 1, _engine->_order_timestamps.size() * 2));
+    }
+    _engine->_order_timestamps[slot] = timestamp;
+  }
+
+  void order_book::enqueue(order_record& o, uint32_t position)
+  {
+    auto&& level = _engine->_levels[o.level()];
+    auto slot = _engine->_orders.slot_of(o);
+    // OrderBookPosition ranks the order on its whole side of the book, so
+    // the orders queued at better levels are subtracted to get its rank in
+    // the level.
+    uint64_t rank = 0;
+    if (position && level.count) {
+      auto ahead = o.side() == side_type::buy ? bids().orders_ahead(_engine->_levels, o.price)
+                                              : asks().orders_ahead(_engine->_levels, o.price);
+      rank = position > ahead ? position - ahead : 1;
+    }
+    if (rank == 0 || rank > level.count) {
+      o.prev = level.tail;
+      o.next = price_level::npos;
+      if (level.tail != price_level::npos) {
+        _engine->_orders.at(level.tail).next = slot;
+      } else {
+        level.head = slot;
+      }
+      level.tail = slot;
+    } else {
+      // Find the order currently holding the rank from the nearer end and
+      // queue ahead of it.
+      uint32_t at;
+      if (rank <= level.count / 2 + 1) {
+        at = level.head;
+        for (uint64_t n = 1; n < rank; n++) {
+          at = _engine->_orders.at(at).next;
+        }
+      } else {
+        at = level.tail;
+        for (uint64_t n = level.count; n > rank; n--) {
+          at = _engine->_orders.at(at).prev;
+        }
+      }
+      auto&& successor = _engine->_orders.at(at);
+      o.prev = successor.prev;
+      o.next = at;
+      if (successor.prev != price_level::npos) {
+        _engine->_orders.at(successor.prev).next = slot;
+      } else {
+        level.head = slot;
+      }
+      successor.prev = slot;
+    }
+    level.count++;
+    count_orders(o, 1);
+  }
+
+  void order_book::dequeue(const order_record& o)
+  {
+    auto&& level = _engine->_levels[o.level()];
+    if (o.prev != price_level::npos) {
+      _engine->_orders.at(o.prev).next = o.next;
+    } else {
+      level.head = o.next;
+    }
+    if (o.next != price_level::npos) {
+      _engine->_orders.at(o.next).prev = o.prev;
+    } else {
+      level.tail = o.prev;
+    }
+    level.count--;
+    count_orders(o, -1);
+  }
+
+  void order_book::count_orders(const order_record& o, int64_t n)
+  {
+    if (o.side() == side_type::buy) {
+      bids().count_orders(o.price, n);
+    } else {
+      asks().count_orders(o.price, n);
+    }
   }
 
   void order_book::cancel(uint64_t order_id, uint64_t quantity)
   {
     //std::scoped_lock lock(guard);
-    auto it = _orders.find(order_id);
-    if (it == _orders.end()) {
+    auto* o = lookup(order_id);
+    if (!o) {
       fmt::print("\norder_book::cancel()::order id: {} with symbol: {}", order_id, this->symbol());
       return;
       //throw std::invalid_argument(std::string("invalid order id: ") + std::to_string(order_id));
     }
-    
-    _orders.modify(it, [quantity](order& order) {
-      order.quantity -= quantity;
-      order.level->size -= quantity;
-                   });
+    cancel_impl(*o, quantity);
+  }
 
-    if (!it->quantity) {
-      remove_impl(it);
+  void order_book::cancel(uint64_t order_id, side_type side, uint64_t quantity)
+  {
+    auto* o = _engine->_orders.find(order_id, side, _book);
+    if (!o) {
+      fmt::print("\norder_book::cancel()::order id: {} with symbol: {}", order_id, this->symbol());
+      return;
+    }
+    cancel_impl(*o, quantity);
+  }
+
+  void order_book::cancel_impl(order_record& o, uint64_t quantity)
+  {
+    o.quantity -= quantity;
+    _engine->_levels[o.level()].size -= quantity;
+    if (!o.quantity) {
+      remove_impl(o);
+    } else {
+      note_level_change(o);
     }
   }
 
   execution order_book::execute(uint64_t order_id, uint64_t quantity)
   {
     //std::scoped_lock lock(guard);
-    auto it = _orders.find(order_id);
-    if (it == _orders.end()) {
+    auto* o = lookup(order_id);
+    if (!o) {
       fmt::print("\norder_book::execute()::order id: {} with symbol: {}", order_id, this->symbol());
       return execution{};
       //throw std::invalid_argument(std::string("invalid order id: ") + std::to_string(order_id));
     }
-    _orders.modify(it, [quantity](order& order) {
-      order.quantity -= quantity;
-      order.level->size -= quantity;
-                   });
-    auto result = execution(it->price, it->side, it->level->size);
-    if (!it->quantity) {
-      remove_impl(it);
+    return execute_impl(*o, quantity);
+  }
+
+  execution order_book::execute(uint64_t order_id, side_type side, uint64_t quantity)
+  {
+    auto* o = _engine->_orders.find(order_id, side, _book);
+    if (!o) {
+      fmt::print("\norder_book::execute()::order id: {} with symbol: {}", order_id, this->symbol());
+      return execution{};
+    }
+    return execute_impl(*o, quantity);
+  }
+
+  execution order_book::execute_impl(order_record& o, uint64_t quantity)
+  {
+    o.quantity -= quantity;
+    auto&& level = _engine->_levels[o.level()];
+    level.size -= quantity;
+    auto result = execution(o.price, o.side(), level.size);
+    if (!o.quantity) {
+      remove_impl(o);
+    } else {
+      note_level_change(o);
     }
     return result;
   }
@@ -103,98 +285,151 @@ namespace helix {
   void order_book::remove(uint64_t order_id)
   {
     //std::scoped_lock lock(guard);
-    auto it = _orders.find(order_id);
-    if (it == _orders.end()) {
+    auto* o = lookup(order_id);
+    if (!o) {
       fmt::print("\norder_book::remove()order id: {} with symbol: {}", order_id, this->symbol());
       return;
       //throw std::invalid_argument(std::string("invalid order id: ") + std::to_string(order_id));
     }
-    remove_impl(it);
+    remove_impl(*o);
   }
 
-  void order_book::remove_impl(iterator& iter)
+  void order_book::remove(uint64_t order_id, side_type side)
   {
-    auto&& order = *iter;
-    switch (order.side) {
+    auto* o = _engine->_orders.find(order_id, side, _book);
+    if (!o) {
+      fmt::print("\norder_book::remove()order id: {} with symbol: {}", order_id, this->symbol());
+      return;
+    }
+    remove_impl(*o);
+  }
+
+  void order_book::remove_impl(const order_record& o)
+  {
+    note_level_change(o);
+    switch (o.side()) {
     case side_type::buy: {
-      remove_impl(order, _bids);
+      remove_impl(o, bids());
       break;
     }
     case side_type::sell: {
-      remove_impl(order, _asks);
+      remove_impl(o, asks());
       break;
     }
     default:
-    throw std::invalid_argument(std::string("invalid side: ") + static_cast<char>(order.side));
+    throw std::invalid_argument(std::string("invalid side: ") + static_cast<char>(o.side()));
     }
-    _orders.erase(iter);
+    _engine->_orders.erase(o.id, o.side(), _book);
+    _engine->_order_counts[_book]--;
   }
 
-  template<typename T>
-  void order_book::remove_impl(const order& o, T& levels)
+  order_record* order_book::lookup(uint64_t order_id)
   {
-    auto it = levels.find(o.price);
-    if (it == levels.end()) {
-      fmt::print("\norder_book::remove_impl<T>() price: {} with symbol: {}", o.price, this->symbol());
-      return;
-      //throw std::invalid_argument(std::string("invalid price: ") + std::to_string(o.price));
+    if (auto* o = _engine->_orders.find(order_id, side_type::buy, _book)) {
+      return o;
     }
-    auto&& level = it->second;
-    o.level->size -= o.quantity;
-    if (level.size == 0) {
-      levels.erase(it);
+    return _engine->_orders.find(order_id, side_type::sell, _book);
+  }
+
+  const order_record* order_book::lookup(uint64_t order_id) const
+  {
+    if (auto* o = _engine->_orders.find(order_id, side_type::buy, _book)) {
+      return o;
     }
+    return _engine->_orders.find(order_id, side_type::sell, _book);
   }
 
   template<typename T>
-  price_level& order_book::lookup_or_create(T& levels, uint64_t price)
+  void order_book::remove_impl(const order_record& o, T& levels)
+  {
+    auto&& level = _engine->_levels[o.level()];
+    dequeue(o);
+    level.size -= o.quantity;
+    if (level.count == 0) {
+      levels.erase(_engine->_levels, o.price);
+    }
+  }
+
+  template<typename T>
+  level_pool::handle order_book::lookup_or_create(T& levels, uint64_t price)
+  {
+    return levels.lookup_or_create(_engine->_levels, price);
+  }
+
+  const order_record* order_book::find(uint64_t order_id, side_type side) const
+  {
+    return _engine->_orders.find(order_id, side, _book);
+  }
+
+  uint64_t order_book::order_timestamp(const order_record& o) const
+  {
+    auto slot = _engine->_orders.slot_of(o);
+    if (!_engine->_keep_order_timestamps[_book] || slot >= _engine->_order_timestamps.size()) {
+      return 0;
+    }
+    return _engine->_order_timestamps[slot];
+  }
+
+  const order_record* order_book::front(const price_level& level) const
+  {
+    return level.head != price_level::npos ? &_engine->_orders.at(level.head) : nullptr;
+  }
+
+  const order_record* order_book::ahead(const order_record& o) const
   {
-    price_level level{ price };
-    auto it = levels.emplace(price, std::move(level)).first;
-    return it->second;
+    return o.prev != price_level::npos ? &_engine->_orders.at(o.prev) : nullptr;
+  }
+
+  const order_record* order_book::behind(const order_record& o) const
+  {
+    return o.next != price_level::npos ? &_engine->_orders.at(o.next) : nullptr;
+  }
+
+  size_t order_book::queue_position(const order_record& o) const
+  {
+    size_t position = 1;
+    for (auto prev = o.prev; prev != price_level::npos; prev = _engine->_orders.at(prev).prev) {
+      position++;
+    }
+    return position;
   }
 
   side_type order_book::side(uint64_t order_id) const
   {
     //std::scoped_lock lock(guard);
-    auto it = _orders.find(order_id);
-    if (it == _orders.end()) {
+    auto* o = lookup(order_id);
+    if (!o) {
       fmt::print("\norder_book::side()order id: {} with symbol: {} ", order_id, this->symbol());
       return static_cast<side_type>(0);
       //throw std::invalid_argument(std::string("invalid order id: ") + std::to_string(order_id));
     }
-    return it->side;
+    return o->side();
   }
 
 
   size_t order_book::bid_levels() const
   {
     //std::scoped_lock lock(guard);
-    return _bids.size();
+    return bids().size();
   }
 
   size_t order_book::ask_levels() const
   {
     //std::scoped_lock lock(guard);
-    return _asks.size();
+    return asks().size();
   }
 
   size_t order_book::order_count() const
   {
     //std::scoped_lock lock(guard);
-    return _orders.size();
+    return _engine->_order_counts[_book];
   }
 
   uint64_t order_book::bid_price(size_t level) const
   {
     //std::scoped_lock lock(guard);
-    auto it = _bids.begin();
-    while (it != _bids.end() && level--) {
-      it++;
-    }
-    if (it != _bids.end()) {
-      auto&& level = it->second;
-      return level.price;
+    if (auto h = bids().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h].price;
     }
     return std::numeric_limits<uint64_t>::min();
   }
@@ -202,26 +437,16 @@ namespace helix {
   uint64_t order_book::bid_size(size_t level) const
   {
     //std::scoped_lock lock(guard);
-    auto it = _bids.begin();
-    while (it != _bids.end() && level--) {
-      it++;
-    }
-    if (it != _bids.end()) {
-      auto&& level = it->second;
-      return level.size;
+    if (auto h = bids().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h].size;
     }
     return 0;
   }
 
   price_level order_book::bid_level(size_t level) const
   {
-    auto it = _bids.begin();
-    while (it != _bids.end() && level--) {
-      it++;
-    }
-    if (it != _bids.end()) {
-      auto&& level = it->second;
-      return level;
+    if (auto h = bids().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h];
     }
     return price_level{};
   }
@@ -229,13 +454,8 @@ namespace helix {
   uint64_t order_book::ask_price(size_t level) const
   {
     //std::scoped_lock lock(guard);
-    auto it = _asks.begin();
-    while (it != _asks.end() && level--) {
-      it++;
-    }
-    if (it != _asks.end()) {
-      auto&& level = it->second;
-      return level.price;
+    if (auto h = asks().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h].price;
     }
     return std::numeric_limits<uint64_t>::max();
   }
@@ -243,30 +463,35 @@ namespace helix {
   uint64_t order_book::ask_size(size_t level) const
   {
     //std::scoped_lock lock(guard);
-    auto it = _asks.begin();
-    while (it != _asks.end() && level--) {
-      it++;
-    }
-    if (it != _asks.end()) {
-      auto&& level = it->second;
-      return level.size;
+    if (auto h = asks().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h].size;
     }
     return 0;
   }
 
   price_level order_book::ask_level(size_t level) const
   {
-    auto it = _asks.begin();
-    while (it != _asks.end() && level--) {
-      it++;
-    }
-    if (it != _asks.end()) {
-      auto&& level = it->second;
-      return level;
+    if (auto h = asks().nth(level); h != level_pool::npos) {
+      return _engine->_levels[h];
     }
     return price_level{};
   }
 
+  best_bid_offer order_book::bbo() const
+  {
+    best_bid_offer bbo;
+    if (auto h = bids().nth(0); h != level_pool::npos) {
+      bbo.bid_price = _engine->_levels[h].price;
+      bbo.bid_size = _engine->_levels[h].size;
+    }
+    if (auto h = asks().nth(0); h != level_pool::npos) {
+      bbo.ask_price = _engine->_levels[h].price;
+      bbo.ask_size = _engine->_levels[h].size;
+    }
+    bbo.version = _engine->_bbo_versions[_book];
+    return bbo;
+  }
+
   uint64_t order_book::midprice(size_t level) const
   {
     auto bid = bid_price(level);
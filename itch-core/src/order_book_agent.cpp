@@ -1,8 +1,13 @@
 #include "order_book_agent.h"
 #include <boost/asio/ts/executor.hpp>
 #include <boost/asio/io_context.hpp>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
 
 using boost::asio::dispatch;
+using boost::asio::post;
 using boost::asio::thread_pool;
 using boost::asio::use_future;
 
@@ -20,101 +25,215 @@ namespace helix
     : ob_thread(ob_thread_)
 #endif
     , ob(ob_)
-  { }
-
-
-  void order_book_agent::set_timestamp(uint64_t timestamp) {
-    auto fun = boost::bind(&order_book::set_timestamp, ob, timestamp);
+  {
     if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
-    } else {
-      fun();
+      commands = std::make_unique<command_ring>();
     }
   }
 
-  void order_book_agent::set_state(trading_state state) {
-    auto fun = boost::bind(&order_book::set_state, ob, state);
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
+  void order_book_agent::push(const book_command& cmd) {
+    if (!ob_thread) {
+      apply(cmd);
+      return;
     }
-    else {
-      fun();
+    while (!commands->try_push(cmd)) {
+      // the book thread is behind; make sure it is draining and wait for room
+      schedule_drain();
+      std::this_thread::yield();
     }
+    schedule_drain();
   }
 
-  void order_book_agent::set_state_name(const std::string& state_name) {
-    auto fun = boost::bind(&order_book::set_state_name, ob, state_name);
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
+  void order_book_agent::schedule_drain() {
+    if (drain_scheduled.try_claim()) {
+      post(*ob_thread, [this] { drain(); });
     }
-    else {
-      fun();
+  }
+
+  void order_book_agent::drain() {
+    apply_queued(drain_batch);
+    if (!commands->empty()) {
+      // let other work queued on the pool run between batches
+      post(*ob_thread, [this] { drain(); });
+      return;
+    }
+    drain_scheduled.release();
+    // a command pushed while the flag was still set did not post a drain
+    if (!commands->empty()) {
+      schedule_drain();
     }
   }
 
-  void order_book_agent::add(order order) {
-    auto fun = boost::bind(&order_book::add, ob, std::move(order));
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
+  void order_book_agent::flush() const {
+    if (commands) {
+      apply_queued(command_ring::capacity());
     }
-    else {
-      fun();
+    if (error) {
+      std::rethrow_exception(std::exchange(error, nullptr));
     }
   }
 
-  void order_book_agent::replace(uint64_t order_id, order order) {
-    auto fun = boost::bind(&order_book::replace, ob, order_id, std::move(order));
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
-    }
-    else {
-      fun();
+  void order_book_agent::apply_queued(size_t max) const {
+    commands->consume([this](const book_command& cmd) {
+      // a failed command must not stop the drain, which would leave the flag set and the agent
+      // silent; the error is kept for the next query instead
+      try {
+        apply(cmd);
+      } catch (...) {
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }, max);
+  }
+
+  void order_book_agent::apply(const book_command& cmd) const {
+    switch (cmd.kind) {
+    case book_command::type::set_timestamp:
+      ob->set_timestamp(cmd.args.timestamp);
+      break;
+    case book_command::type::set_state:
+      ob->set_state(cmd.state);
+      break;
+    case book_command::type::set_state_name:
+      ob->set_state_name(std::string(cmd.state_name, cmd.state_name_length));
+      break;
+    case book_command::type::set_decimals_for_price:
+      ob->set_decimals_for_price(static_cast<uint16_t>(cmd.order_id));
+      break;
+    case book_command::type::add:
+      ob->add(order{ cmd.args.id, cmd.args.price, cmd.args.quantity, cmd.side, cmd.args.timestamp },
+              cmd.position);
+      break;
+    case book_command::type::replace:
+      ob->replace(cmd.order_id,
+                  order{ cmd.args.id, cmd.args.price, cmd.args.quantity, cmd.side, cmd.args.timestamp },
+                  cmd.position);
+      break;
+    case book_command::type::modify:
+      ob->modify(cmd.order_id, cmd.side, cmd.args.price, cmd.args.quantity, cmd.args.timestamp,
+                 cmd.position);
+      break;
+    case book_command::type::cancel:
+      if (cmd.side == side_type{}) {
+        ob->cancel(cmd.order_id, cmd.args.quantity);
+      } else {
+        ob->cancel(cmd.order_id, cmd.side, cmd.args.quantity);
+      }
+      break;
+    case book_command::type::remove:
+      if (cmd.side == side_type{}) {
+        ob->remove(cmd.order_id);
+      } else {
+        ob->remove(cmd.order_id, cmd.side);
+      }
+      break;
+    case book_command::type::execute:
+      if (cmd.side == side_type{}) {
+        ob->execute(cmd.order_id, cmd.args.quantity);
+      } else {
+        ob->execute(cmd.order_id, cmd.side, cmd.args.quantity);
+      }
+      break;
     }
   }
+
+  void order_book_agent::set_timestamp(uint64_t timestamp) {
+    book_command cmd{};
+    cmd.kind = book_command::type::set_timestamp;
+    cmd.args.timestamp = timestamp;
+    push(cmd);
+  }
+
+  void order_book_agent::set_state(trading_state state) {
+    book_command cmd{};
+    cmd.kind = book_command::type::set_state;
+    cmd.state = state;
+    push(cmd);
+  }
+
+  void order_book_agent::set_state_name(const std::string& state_name) {
+    book_command cmd{};
+    cmd.kind = book_command::type::set_state_name;
+    cmd.state_name_length = static_cast<uint8_t>(std::min(state_name.size(), sizeof(cmd.state_name)));
+    std::memcpy(cmd.state_name, state_name.data(), cmd.state_name_length);
+    push(cmd);
+  }
+
+  void order_book_agent::add(order order, uint32_t position) {
+    book_command cmd{};
+    cmd.kind = book_command::type::add;
+    cmd.side = order.side;
+    cmd.position = position;
+    cmd.args = { order.id, order.price, order.quantity, order.timestamp };
+    push(cmd);
+  }
+
+  void order_book_agent::replace(uint64_t order_id, order order, uint32_t position) {
+    book_command cmd{};
+    cmd.kind = book_command::type::replace;
+    cmd.side = order.side;
+    cmd.position = position;
+    cmd.order_id = order_id;
+    cmd.args = { order.id, order.price, order.quantity, order.timestamp };
+    push(cmd);
+  }
+
+  void order_book_agent::modify(uint64_t order_id, side_type side, uint64_t price, uint64_t quantity,
+                                uint64_t timestamp, uint32_t position) {
+    book_command cmd{};
+    cmd.kind = book_command::type::modify;
+    cmd.side = side;
+    cmd.position = position;
+    cmd.order_id = order_id;
+    cmd.args = { 0, price, quantity, timestamp };
+    push(cmd);
+  }
+
   void order_book_agent::cancel(uint64_t order_id, uint64_t quantity) {
-    auto fun = boost::bind(&order_book::cancel, ob, order_id, quantity);
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
-    }
-    else {
-      fun();
-    }
+    cancel(order_id, side_type{}, quantity);
+  }
+
+  void order_book_agent::cancel(uint64_t order_id, side_type side, uint64_t quantity) {
+    book_command cmd{};
+    cmd.kind = book_command::type::cancel;
+    cmd.side = side;
+    cmd.order_id = order_id;
+    cmd.args.quantity = quantity;
+    push(cmd);
   }
 
   void order_book_agent::remove(uint64_t order_id) {
-    auto fun = boost::bind(&order_book::remove, ob, order_id);
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
-    }
-    else {
-      fun();
-    }
+    remove(order_id, side_type{});
+  }
+
+  void order_book_agent::remove(uint64_t order_id, side_type side) {
+    book_command cmd{};
+    cmd.kind = book_command::type::remove;
+    cmd.side = side;
+    cmd.order_id = order_id;
+    push(cmd);
   }
 
 
   void order_book_agent::set_decimals_for_price(uint16_t dec) {
-    auto fun = boost::bind(&order_book::set_decimals_for_price, ob, dec);
-    if (ob_thread) {
-      dispatch(*ob_thread, std::move(fun));
-    }
-    else {
-      fun();
-    }
+    book_command cmd{};
+    cmd.kind = book_command::type::set_decimals_for_price;
+    cmd.order_id = dec;
+    push(cmd);
   }
   
-  execution order_book_agent::execute(uint64_t order_id, uint64_t quantity) {
-    if (ob_thread)
-    {
-      auto ret = dispatch(*ob_thread,
-                          use_future(
-                            boost::bind(&order_book::execute, ob, order_id, quantity)
-                          ));
-      return ret.get();
-    }
-    else
-    {
-      return ob->execute(order_id, quantity);
-    }
+  void order_book_agent::execute(uint64_t order_id, uint64_t quantity) {
+    execute(order_id, side_type{}, quantity);
+  }
+
+  void order_book_agent::execute(uint64_t order_id, side_type side, uint64_t quantity) {
+    book_command cmd{};
+    cmd.kind = book_command::type::execute;
+    cmd.side = side;
+    cmd.order_id = order_id;
+    cmd.args.quantity = quantity;
+    push(cmd);
   }
 
 
@@ -124,6 +243,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->symbol();
                                  }));
       return ret.get();
@@ -140,6 +260,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->timestamp();
                                  }));
       return ret.get();
@@ -156,6 +277,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->state();
                                  }));
       return ret.get();
@@ -172,6 +294,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->state_name();
                                  }));
       return ret.get();
@@ -199,6 +322,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->side(order_id);
                                  }));
       return ret.get();
@@ -215,6 +339,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->bid_levels();
                                  }));
       return ret.get();
@@ -231,6 +356,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->ask_levels();
                                  }));
       return ret.get();
@@ -247,6 +373,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([this]
                                  {
+                                   flush();
                                    return ob->order_count();
                                  }));
       return ret.get();
@@ -263,6 +390,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->bid_price(level);
                                  }));
       return ret.get();
@@ -279,6 +407,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->bid_size(level);
                                  }));
       return ret.get();
@@ -295,6 +424,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->ask_price(level);
                                  }));
       return ret.get();
@@ -311,6 +441,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->ask_size(level);
                                  }));
       return ret.get();
@@ -327,6 +458,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->midprice(level);
                                  }));
       return ret.get();
@@ -343,6 +475,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->bid_level(level);
                                  }));
       return ret.get();
@@ -359,6 +492,7 @@ namespace helix
       auto ret = dispatch(*ob_thread,
                       use_future([&]
                                  {
+                                   flush();
                                    return ob->ask_level(level);
                                  }));
       return ret.get();
@@ -369,4 +503,21 @@ namespace helix
     }
   }
 
+  best_bid_offer order_book_agent::bbo() const {
+    if (ob_thread)
+    {
+      auto ret = dispatch(*ob_thread,
+                      use_future([this]
+                                 {
+                                   flush();
+                                   return ob->bbo();
+                                 }));
+      return ret.get();
+    }
+    else
+    {
+      return ob->bbo();
+    }
+  }
+
 } // namespace helix
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "thread_topology.hh"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace helix {
+
+thread_topology thread_topology::parse(std::istream& in)
+{
+    thread_topology topology;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields{ line };
+        std::string role;
+        if (!(fields >> role)) {
+            continue;
+        }
+        thread_placement placement;
+        if (!(fields >> placement.cpu)) {
+            throw std::invalid_argument("invalid topology line: " + line);
+        }
+        fields >> placement.numa_node;
+        if (role == "feed") {
+            topology.feed = placement;
+        } else if (role == "algo") {
+            topology.algos.push_back(placement);
+        } else {
+            throw std::invalid_argument("invalid thread role: " + role);
+        }
+    }
+    return topology;
+}
+
+void pin_thread_pool(boost::asio::thread_pool& pool, const thread_placement& placement)
+{
+    if (!placement.pinned()) {
+        return;
+    }
+    boost::asio::post(pool, boost::asio::use_future([placement] { pin_current_thread(placement); })).get();
+}
+
+#ifdef __linux__
+
+// The memory policy calls are not wrapped by glibc; the values come from
+// <linux/mempolicy.h>.
+static constexpr int mpol_default = 0;
+static constexpr int mpol_preferred = 1;
+static constexpr size_t max_numa_nodes = 1024;
+static constexpr size_t node_mask_words = max_numa_nodes / (8 * sizeof(unsigned long));
+
+void pin_current_thread(const thread_placement& placement)
+{
+    if (!placement.pinned()) {
+        return;
+    }
+    if (placement.cpu >= 0) {
+        if (placement.cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("invalid cpu: " + std::to_string(placement.cpu));
+        }
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement.cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+            throw std::system_error(errno, std::generic_category(), "sched_setaffinity");
+        }
+    }
+    int node = placement.numa_node >= 0 ? placement.numa_node : current_numa_node();
+    if (node < 0 || static_cast<size_t>(node) >= max_numa_nodes) {
+        throw std::invalid_argument("invalid numa node: " + std::to_string(node));
+    }
+    unsigned long nodes[node_mask_words] = {};
+    nodes[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_set_mempolicy, mpol_preferred, nodes, max_numa_nodes + 1) != 0) {
+        throw std::system_error(errno, std::generic_category(), "set_mempolicy");
+    }
+}
+
+std::vector<int> current_thread_cpus()
+{
+    std::vector<int> result;
+    cpu_set_t cpus;
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+        throw std::system_error(errno, std::generic_category(), "sched_getaffinity");
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+int current_numa_node()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        throw std::system_error(errno, std::generic_category(), "getcpu");
+    }
+    return static_cast<int>(node);
+}
+
+int current_memory_node()
+{
+    int mode = mpol_default;
+    unsigned long nodes[node_mask_words] = {};
+    if (syscall(SYS_get_mempolicy, &mode, nodes, max_numa_nodes + 1, nullptr, 0UL) != 0) {
+        throw std::system_error(errno, std::generic_category(), "get_mempolicy");
+    }
+    if (mode == mpol_default) {
+        return -1;
+    }
+    for (size_t node = 0; node < max_numa_nodes; node++) {
+        if (nodes[node / (8 * sizeof(unsigned long))] & (1UL << (node % (8 * sizeof(unsigned long))))) {
+            return static_cast<int>(node);
+        }
+    }
+    return -1;
+}
+
+long current_thread_id()
+{
+    return static_cast<long>(syscall(SYS_gettid));
+}
+
+#elif defined(_WIN32)
+
+// Windows has no per-thread memory policy; memory is taken from the node of
+// the thread's ideal processor, which pinning sets. A placement with a node
+// but no CPU lets the thread run on any CPU of the node.
+
+void pin_current_thread(const thread_placement& placement)
+{
+    if (placement.cpu < 0) {
+        if (placement.numa_node < 0) {
+            return;
+        }
+        if (placement.numa_node > 0xffff) {
+            throw std::invalid_argument("invalid numa node: " + std::to_string(placement.numa_node));
+        }
+        GROUP_AFFINITY affinity{};
+        if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(placement.numa_node), &affinity)) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "GetNumaNodeProcessorMaskEx");
+        }
+        if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "SetThreadGroupAffinity");
+        }
+        return;
+    }
+    if (placement.cpu >= static_cast<int>(8 * sizeof(DWORD_PTR))) {
+        throw std::invalid_argument("invalid cpu: " + std::to_string(placement.cpu));
+    }
+    if (!SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << placement.cpu)) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "SetThreadAffinityMask");
+    }
+    SetThreadIdealProcessor(GetCurrentThread(), static_cast<DWORD>(placement.cpu));
+}
+
+std::vector<int> current_thread_cpus()
+{
+    std::vector<int> result;
+    GROUP_AFFINITY affinity;
+    if (!GetThreadGroupAffinity(GetCurrentThread(), &affinity)) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "GetThreadGroupAffinity");
+    }
+    for (int cpu = 0; cpu < static_cast<int>(8 * sizeof(KAFFINITY)); cpu++) {
+        if (affinity.Mask & (KAFFINITY{ 1 } << cpu)) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+int current_numa_node()
+{
+    UCHAR node = 0;
+    if (!GetNumaProcessorNode(static_cast<UCHAR>(GetCurrentProcessorNumber()), &node)) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "GetNumaProcessorNode");
+    }
+    return node;
+}
+
+int current_memory_node()
+{
+    return -1;
+}
+
+long current_thread_id()
+{
+    return static_cast<long>(GetCurrentThreadId());
+}
+
+#else
+
+void pin_current_thread(const thread_placement& placement)
+{
+    if (placement.pinned()) {
+        throw std::system_error(std::make_error_code(std::errc::not_supported), "pin_current_thread");
+    }
+}
+
+std::vector<int> current_thread_cpus()
+{
+    return {};
+}
+
+int current_numa_node()
+{
+    return 0;
+}
+
+int current_memory_node()
+{
+    return -1;
+}
+
+long current_thread_id()
+{
+    return 0;
+}
+
+#endif
+
+}
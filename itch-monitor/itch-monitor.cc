@@ -49,14 +49,13 @@ struct config {
 	std::string format;
 	std::string input;
 	std::string output;
+	bool coalesce;
 };
 
 struct trace_session {
 	socket_address addr;
-	double	bid_price = 0;
-	uint64_t	bid_size = 0;
-	double	ask_price = UINT64_MAX;
-	uint64_t	ask_size = 0;
+	// top of book of each symbol, read without a lock once the input is done
+	std::vector<std::pair<std::string, helix_top_of_book_t>> tops;
 };
 
 struct trace_fmt_ops {
@@ -131,23 +130,17 @@ static double get_price(helix_order_book_t ob, helix_price_t price)
 	return p;
 }
 
-static bool is_order_book_changed(helix_session_t session, helix_event_t event)
+static bool is_order_book_changed(helix_event_t event)
 {
 	auto event_mask = helix_event_mask(event);
 	if (event_mask & HELIX_EVENT_TRADE) {
 		return true;
 	}
-	if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
-		auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
-		auto ob = helix_event_order_book(event);
-		auto bid_price = get_price(ob, helix_order_book_bid_price(ob, 0));
-		auto bid_size  = helix_order_book_bid_size(ob, 0);
-		auto ask_price = get_price(ob, helix_order_book_ask_price(ob, 0));
-		auto ask_size  = helix_order_book_ask_size(ob, 0);
-		if (!bid_price || !ask_size) {
-			return false;
-		}
-		return bid_price != ts->bid_price || bid_size != ts->bid_size || ask_price != ts->ask_price || ask_size != ts->ask_size;
+	// the session flags book updates that moved the best bid or offer
+	if (event_mask & HELIX_EVENT_BBO_CHANGED) {
+		helix_bbo_t bbo;
+		helix_event_bbo(event, &bbo);
+		return bbo.bid_price && bbo.ask_size;
 	}
 	return false;
 }
@@ -168,9 +161,8 @@ struct fmt_pretty_ops final
 	void fmt_event(helix_session_t session, helix_event_t event) override
 	{
 		using namespace std::chrono;
-		auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
 		auto timestamp = helix_event_timestamp(event);
-		if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(session, event)) {
+		if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(event)) {
 			return;
 		}
 		nanoseconds ns(*reinterpret_cast<uint64_t*>(&timestamp));
@@ -188,11 +180,13 @@ struct fmt_pretty_ops final
 		auto event_mask = helix_event_mask(event);
 		if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
 			auto ob = helix_event_order_book(event);
+			helix_bbo_t bbo;
+			helix_event_bbo(event, &bbo);
 
-			auto bid_price = get_price(ob, helix_order_book_bid_price(ob, 0));
-			auto bid_size  = helix_order_book_bid_size(ob, 0);
-			auto ask_price = get_price(ob, helix_order_book_ask_price(ob, 0));
-			auto ask_size  = helix_order_book_ask_size(ob, 0);
+			auto bid_price = get_price(ob, bbo.bid_price);
+			auto bid_size  = bbo.bid_size;
+			auto ask_price = get_price(ob, bbo.ask_price);
+			auto ask_size  = bbo.ask_size;
 
 			fprintf(output, "%6" PRIu64"  %6.3f  %6.3f  %-6" PRIu64" |",
 							bid_size,
@@ -200,11 +194,6 @@ struct fmt_pretty_ops final
 							(double)ask_price,
 							ask_size
 			);
-
-			ts->bid_price = bid_price;
-			ts->bid_size  = bid_size;
-			ts->ask_price = ask_price;
-			ts->ask_size  = ask_size;
 		}
 		else {
 			fprintf(output, "                               |");
@@ -245,9 +234,8 @@ struct fmt_csv_ops final
 	}
 
 	void fmt_event(helix_session_t session, helix_event_t event) override {
-		auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
 		auto timestamp = helix_event_timestamp(event);
-		if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(session, event)) {
+		if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(event)) {
 			return;
 		}
 		auto symbol = helix_event_symbol(event);
@@ -255,11 +243,13 @@ struct fmt_csv_ops final
 		auto event_mask = helix_event_mask(event);
 		if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
 			auto ob = helix_event_order_book(event);
+			helix_bbo_t bbo;
+			helix_event_bbo(event, &bbo);
 
-			auto bid_price = get_price(ob, helix_order_book_bid_price(ob, 0));
-			auto bid_size  = helix_order_book_bid_size(ob, 0);
-			auto ask_price = get_price(ob, helix_order_book_ask_price(ob, 0));
-			auto ask_size  = helix_order_book_ask_size(ob, 0);
+			auto bid_price = get_price(ob, bbo.bid_price);
+			auto bid_size  = bbo.bid_size;
+			auto ask_price = get_price(ob, bbo.ask_price);
+			auto ask_size  = bbo.ask_size;
 
 			fprintf(output, "%f,%" PRIu64",%f,%" PRIu64",",
 							bid_price,
@@ -267,11 +257,6 @@ struct fmt_csv_ops final
 							ask_price,
 							ask_size
 			);
-
-			ts->bid_price = bid_price;
-			ts->bid_size = bid_size;
-			ts->ask_price = ask_price;
-			ts->ask_size = ask_size;
 		}
 		else {
 			fprintf(output, ",,,,");
@@ -375,6 +360,7 @@ static void usage(void)
 					"    -i, --input filename           Input filename.\n"
 					"    -o, --output filename          Output filename.\n"
 					"    -f, --format format            Output format (pretty, csv).\n"
+					"    -c, --coalesce                 Emit one event per symbol and packet.\n"
 					"    -h, --help                     display this help and exit\n",
 					program);
 	exit(1);
@@ -392,6 +378,15 @@ int main(int argc, char* argv[])
 	std::ifstream input_fd;
 
 	cfg.output = argv[2];
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-c" || arg == "--coalesce") {
+			cfg.coalesce = true;
+		} else {
+			fprintf(stderr, "error: unknown option '%s'\n", argv[i]);
+			exit(1);
+		}
+	}
 	fmt_ops.reset(new fmt_pretty_ops);
 	fmt_ops->init(cfg.output);
 
@@ -408,11 +403,16 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
+	helix_session_set_coalescing(session, cfg.coalesce);
+
 	cfg.symbols = { "AKBNK.E" };
 	//cfg.symbols = { "TSKB.E" };
 	cfg.max_orders = 200000;
 	for (auto&& symbol : cfg.symbols) {
 		helix_session_subscribe(session, symbol.c_str(), cfg.max_orders);
+		if (auto top = helix_session_top_of_book(session, symbol.c_str(), cfg.max_orders)) {
+			ts.tops.emplace_back(symbol, top);
+		}
 	}
 
 	helix_session_set_send_callback(session, process_send);
@@ -441,6 +441,16 @@ int main(int argc, char* argv[])
 			p += nr;
 			size -= nr;
 		}
+		helix_session_flush(session);
+	}
+	for (auto&& [symbol, top] : ts.tops) {
+		helix_quote_t quote;
+		helix_top_of_book_read(top, &quote);
+		fprintf(stderr, "%s last quote: %" PRIu64 " @ %" PRIu64 " / %" PRIu64 " @ %" PRIu64 ", last trade: %" PRIu64 " @ %" PRIu64 "\n",
+						symbol.c_str(),
+						quote.bid_size, quote.bid_price,
+						quote.ask_size ? quote.ask_price : 0, quote.ask_size,
+						quote.last_size, quote.last_price);
 	}
 	helix_session_destroy(session);
 
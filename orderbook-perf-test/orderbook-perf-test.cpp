@@ -3,9 +3,22 @@
 
 #include <iostream>
 #include <order_book.hh>
+#include <order_book_arena.hh>
+#include <nasdaq/itch_bist_decoder.hh>
+#include <nasdaq/itch_bist_handler.hh>
+#include <nasdaq/itch_bist_sharded_handler.hh>
+#include <order_book_agent.h>
+#include <coroutine_algo.h>
+#include <boost/asio/ts/executor.hpp>
+#include <boost/bind/bind.hpp>
+#include <algorithm>
 #include <chrono>
+#include <thread>
 #include <time.h>
+#include <map>
+#include <string>
 #include <vector>
+#include <cstring>
 
 using namespace helix;
 
@@ -68,18 +81,573 @@ auto test_remove(order_book& ob, size_t count)
   return end - start;
 }
 
-int main()
+// Builds a payload of add, execute and delete messages in wire format, for
+// order books 70616 and up, taking turns.
+std::vector<char> make_itch_payload(size_t count, uint32_t instruments = 1)
 {
-  size_t count = 20000000;
+  std::vector<char> payload;
+  auto append = [&payload](const auto& msg) {
+    auto* p = reinterpret_cast<const char*>(&msg);
+    payload.insert(payload.end(), p, p + sizeof(msg));
+  };
+  for (size_t i = 0; i < count; i++) {
+    uint64_t id = nasdaq::byteswap(uint64_t{ i / 3 });
+    uint32_t book = nasdaq::byteswap(static_cast<uint32_t>(70616 + (i / 3) % instruments));
+    uint32_t ts = nasdaq::byteswap(static_cast<uint32_t>(i));
+    switch (i % 3) {
+    case 0: {
+      itch_bist_add_order m{};
+      m.MessageType = 'A';
+      m.TimestampNanoseconds = ts;
+      m.OrderID = id;
+      m.OrderBookID = book;
+      m.Side = 'B';
+      m.Quantity = nasdaq::byteswap(quantity);
+      m.Price = nasdaq::byteswap(uint32_t{ 8000 });
+      append(m);
+      break;
+    }
+    case 1: {
+      itch_bist_order_executed m{};
+      m.MessageType = 'E';
+      m.TimestampNanoseconds = ts;
+      m.OrderID = id;
+      m.OrderBookID = book;
+      m.Side = 'B';
+      m.ExecutedQuantity = nasdaq::byteswap(quantity / 2);
+      append(m);
+      break;
+    }
+    default: {
+      itch_bist_order_delete m{};
+      m.MessageType = 'D';
+      m.TimestampNanoseconds = ts;
+      m.OrderID = id;
+      m.OrderBookID = book;
+      m.Side = 'B';
+      append(m);
+      break;
+    }
+    }
+  }
+  return payload;
+}
+
+// Decoding alone, without touching an order book.
+auto test_decode(const std::vector<char>& payload, size_t count)
+{
+  std::vector<nasdaq::itch_bist_decoded_message> msgs;
+  msgs.reserve(count);
+  auto start = clock_type::now();
+  nasdaq::itch_bist_decode_payload(net::packet_view{ payload.data(), payload.size() }, msgs);
+  auto end = clock_type::now();
+  if (msgs.size() != count) {
+    std::cout << "oupss!\n";
+  }
+  return end - start;
+}
+
+// Counts events, called by the handler without type erasure.
+struct counting_listener {
+  size_t events{ 0 };
+  void on_event(const event&) { events++; }
+};
 
+// Applying decoded messages to a book and passing the events to a listener.
+template<typename Listener>
+auto test_handler(nasdaq::itch_bist_handler<Listener>& handler,
+                  const std::vector<nasdaq::itch_bist_decoded_message>& msgs)
+{
+  nasdaq::itch_bist_decoded_message directory{};
+  directory.MessageType = 'R';
+  directory.order_book_directory.OrderBookID = 70616;
+  std::memcpy(directory.order_book_directory.Symbol, "AXP     ", ITCH_SYMBOL_LEN);
+  order_book ob{ "AXP", 0, msgs.size() };
+  handler.register_for_symbol("AXP", std::make_unique<order_book_agent>(&ob));
+  handler.process_messages(&directory, 1);
+  auto start = clock_type::now();
+  handler.process_messages(msgs.data(), msgs.size());
+  auto end = clock_type::now();
+  return end - start;
+}
+
+// Handing adds to a book thread with one asio handler per message, the way
+// order_book_agent used to.
+auto test_handoff_asio(size_t count)
+{
+  thread_pool pool{ 1 };
+  order_book ob{ "AXP", 0, count };
+  auto start = clock_type::now();
+  for (size_t i = 0; i < count; i++) {
+    order o{ i, 8000, quantity, side_type::buy, i };
+    boost::asio::dispatch(pool, boost::bind(&order_book::add, &ob, std::move(o), uint32_t{ 0 }));
+  }
+  auto orders = boost::asio::dispatch(pool, boost::asio::use_future([&ob] { return ob.order_count(); })).get();
+  auto end = clock_type::now();
+  if (orders != count) {
+    std::cout << "oupss!\n";
+  }
+  pool.join();
+  return end - start;
+}
+
+// Handing adds to a book thread through the command ring of the agent. Debug
+// builds apply commands in place, so only release numbers compare.
+auto test_handoff_ring(size_t count)
+{
+  thread_pool pool{ 1 };
   order_book ob{ "AXP", 0, count };
+  order_book_agent agent{ &pool, &ob };
+  auto start = clock_type::now();
+  for (size_t i = 0; i < count; i++) {
+    order o{ i, 8000, quantity, side_type::buy, i };
+    agent.add(std::move(o));
+  }
+  auto orders = agent.order_count();
+  auto end = clock_type::now();
+  if (orders != count) {
+    std::cout << "oupss!\n";
+  }
+  pool.join();
+  return end - start;
+}
+
+// Lists instruments on order books 70616 and up, in wire format.
+std::vector<char> make_itch_directory(uint32_t instruments)
+{
+  std::vector<char> payload;
+  for (uint32_t i = 0; i < instruments; i++) {
+    itch_bist_order_book_directory m{};
+    m.MessageType = 'R';
+    m.OrderBookID = nasdaq::byteswap(70616 + i);
+    auto symbol = "S" + std::to_string(i);
+    symbol.resize(ITCH_SYMBOL_LEN, ' ');
+    std::memcpy(m.Symbol, symbol.data(), ITCH_SYMBOL_LEN);
+    auto* p = reinterpret_cast<const char*>(&m);
+    payload.insert(payload.end(), p, p + sizeof(m));
+  }
+  return payload;
+}
+
+// Feeding a payload to a handler in packets of 64 messages, like a session,
+// until every message is applied.
+template<typename Handler>
+auto test_feed(Handler& handler, uint32_t instruments, const std::vector<char>& payload)
+{
+  for (uint32_t i = 0; i < instruments; i++) {
+    handler.share_top_of_book("S" + std::to_string(i), 1024);
+  }
+  auto directory = make_itch_directory(instruments);
+  for (size_t offset = 0; offset < directory.size();) {
+    offset += handler.process_packet(net::packet_view{ directory.data() + offset, directory.size() - offset });
+  }
+  handler.flush_events();
+  auto start = clock_type::now();
+  size_t msgs = 0;
+  for (size_t offset = 0; offset < payload.size();) {
+    offset += handler.process_packet(net::packet_view{ payload.data() + offset, payload.size() - offset });
+    if (++msgs % 64 == 0) {
+      handler.flush_events();
+    }
+  }
+  handler.flush_events();
+  if constexpr (requires { handler.wait(); }) {
+    handler.wait();
+  }
+  auto end = clock_type::now();
+  return end - start;
+}
+
+// Keeps the events a handler passes on.
+struct recording_listener {
+  std::vector<event> events;
+  void on_event(const event& ev) { events.push_back(ev); }
+};
+
+// Whether two events are of the same symbol and carry the same mask,
+// timestamp, trade and BBO.
+bool same_event(const event& a, const event& b)
+{
+  if (a.get_mask() != b.get_mask() || a.get_symbol() != b.get_symbol()
+      || a.get_timestamp() != b.get_timestamp()) {
+    return false;
+  }
+  if (a.get_mask() & ev_trade) {
+    auto* x = a.get_trade();
+    auto* y = b.get_trade();
+    if (x->price != y->price || x->size != y->size || x->sign != y->sign) {
+      return false;
+    }
+  }
+  if (a.get_mask() & ev_order_book_update) {
+    auto& x = a.get_bbo();
+    auto& y = b.get_bbo();
+    if (x.bid_price != y.bid_price || x.bid_size != y.bid_size
+        || x.ask_price != y.ask_price || x.ask_size != y.ask_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Feeding a payload in packets of 64 messages to a handler that coalesces
+// and to one that does not, and checking that each packet gives one event
+// per instrument, in the order the instruments were first touched, with the
+// masks of its events or-ed together and the last timestamp, trade and BBO.
+void check_coalescing(uint32_t instruments, const std::vector<char>& payload)
+{
+  nasdaq::itch_bist_handler<recording_listener> plain;
+  nasdaq::itch_bist_handler<recording_listener> coalesced;
+  coalesced.set_coalescing(true);
+  auto directory = make_itch_directory(instruments);
+  for (auto* handler : { &plain, &coalesced }) {
+    for (uint32_t i = 0; i < instruments; i++) {
+      handler->share_top_of_book("S" + std::to_string(i), 1024);
+    }
+    for (size_t offset = 0; offset < directory.size();) {
+      offset += handler->process_packet(net::packet_view{ directory.data() + offset, directory.size() - offset });
+    }
+  }
+  size_t msgs = 0;
+  for (size_t offset = 0; offset < payload.size();) {
+    net::packet_view packet{ payload.data() + offset, payload.size() - offset };
+    offset += plain.process_packet(packet);
+    coalesced.process_packet(packet);
+    if (++msgs % 64 != 0 && offset < payload.size()) {
+      continue;
+    }
+    coalesced.flush_events();
+    std::vector<event> expected;
+    for (auto& ev : plain.listener().events) {
+      auto it = std::find_if(expected.begin(), expected.end(), [&ev](const event& e) {
+        return e.get_instrument() == ev.get_instrument();
+      });
+      if (it == expected.end()) {
+        expected.push_back(ev);
+        continue;
+      }
+      auto t = ev.get_mask() & ev_trade ? *ev.get_trade() : *it->get_trade();
+      auto bbo = ev.get_mask() & ev_order_book_update ? ev.get_bbo() : it->get_bbo();
+      *it = event{ it->get_mask() | ev.get_mask(), ev.get_symbol(), ev.get_timestamp(), std::move(t), ev.get_instrument() };
+      it->set_bbo(bbo);
+    }
+    auto& events = coalesced.listener().events;
+    if (events.size() != expected.size() || !std::equal(events.begin(), events.end(), expected.begin(), same_event)) {
+      std::cout << "oupss!\n";
+    }
+    plain.listener().events.clear();
+    events.clear();
+  }
+}
+
+// Feeding a payload to a handler and to a sharded one, and checking that
+// every instrument gets the same events in the same order and ends up with
+// the same book.
+void check_sharding(uint32_t instruments, size_t shards, const std::vector<char>& payload)
+{
+  nasdaq::itch_bist_handler<recording_listener> plain;
+  nasdaq::itch_bist_sharded_handler<recording_listener> sharded{ shards };
+  std::vector<std::pair<const book_publisher*, const book_publisher*>> books;
+  for (uint32_t i = 0; i < instruments; i++) {
+    auto symbol = "S" + std::to_string(i);
+    books.emplace_back(&plain.share_book(symbol, 1024), &sharded.share_book(symbol, 1024));
+  }
+  test_feed(plain, instruments, payload);
+  test_feed(sharded, instruments, payload);
+  auto by_symbol = [](const std::vector<event>& events) {
+    std::map<std::string_view, std::vector<const event*>> out;
+    for (auto& ev : events) {
+      out[ev.get_symbol()].push_back(&ev);
+    }
+    return out;
+  };
+  auto expected = by_symbol(plain.listener().events);
+  for (size_t i = 0; i < shards; i++) {
+    for (auto& [symbol, events] : by_symbol(sharded.listener(i).events)) {
+      auto& e = expected[symbol];
+      if (events.size() != e.size() || !std::equal(events.begin(), events.end(), e.begin(),
+          [](const event* a, const event* b) { return same_event(*a, *b); })) {
+        std::cout << "oupss!\n";
+      }
+      e.clear();
+    }
+  }
+  for (auto& [symbol, events] : expected) {
+    if (!events.empty()) {
+      std::cout << "oupss!\n";
+    }
+  }
+  auto same_levels = [](const book_snapshot::level* a, const book_snapshot::level* b) {
+    return std::equal(a, a + book_snapshot::depth, b, [](auto& x, auto& y) {
+      return x.price == y.price && x.size == y.size && x.count == y.count;
+    });
+  };
+  for (auto [a, b] : books) {
+    auto x = a->read();
+    auto y = b->read();
+    if (x.timestamp != y.timestamp || x.order_count != y.order_count || x.bid_levels != y.bid_levels
+        || x.ask_levels != y.ask_levels || !same_levels(x.bids, y.bids) || !same_levels(x.asks, y.asks)) {
+      std::cout << "oupss!\n";
+    }
+  }
+}
+
+// Session that passes events the test makes straight to its callback.
+class loopback_session : public session {
+  event_callback _callback;
+public:
+  loopback_session()
+    : session{ nullptr } { }
+
+  void register_callback(event_callback callback) override {
+    _callback = std::move(callback);
+  }
+  std::string subscribe(const std::string& symbol, size_t /*max_orders*/) override {
+    return symbol;
+  }
+  void set_send_callback(send_callback /*callback*/) override { }
+  bool is_rth_timestamp(uint64_t /*timestamp*/) override {
+    return true;
+  }
+  size_t process_packet(const net::packet_view& packet) override {
+    return packet.len();
+  }
+
+  void send(std::shared_ptr<event> ev) {
+    _callback(std::move(ev));
+  }
+};
+
+uint64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records how long after its timestamp each event reaches tick().
+class latency_algo : public algo_base {
+public:
+  std::vector<uint64_t> latencies;
+
+  latency_algo(std::weak_ptr<session> s, std::string symbol, size_t count, event_loop_options loop = {})
+    : algo_base{ std::move(s), {}, loop }
+  {
+    latencies.reserve(count);
+    register_callback(std::move(symbol));
+  }
+  latency_algo(std::weak_ptr<session> s, std::string symbol, size_t count, algo_scheduler& scheduler,
+               thread_placement placement = {})
+    : algo_base{ std::move(s), scheduler, placement }
+  {
+    latencies.reserve(count);
+    register_callback(std::move(symbol));
+  }
+  ~latency_algo() override {
+    join_events();
+  }
+
+  int tick(event* ev) override {
+    latencies.push_back(steady_ns() - ev->get_timestamp());
+    return 0;
+  }
+};
+
+// Records how long after its timestamp each event reaches run().
+class latency_coroutine : public coroutine_algo {
+  std::string _symbol;
+public:
+  std::vector<uint64_t> latencies;
+
+  latency_coroutine(std::weak_ptr<session> s, std::string symbol, size_t count, algo_scheduler& scheduler)
+    : coroutine_algo{ std::move(s), scheduler }
+    , _symbol{ std::move(symbol) }
+  {
+    latencies.reserve(count);
+    subscribe(_symbol);
+    start();
+  }
+  ~latency_coroutine() override {
+    stop_run();
+  }
+
+  algo_task run() override {
+    for (;;) {
+      const event& ev = co_await next_event(_symbol);
+      latencies.push_back(steady_ns() - ev.get_timestamp());
+    }
+  }
+};
+
+// Waking an idle algo thread with one event at a time, gap apart, and
+// measuring the time from the send to tick().
+auto test_wake_latency(event_loop_options loop, size_t count, std::chrono::microseconds gap)
+{
+  auto s = std::make_shared<loopback_session>();
+  latency_algo algo{ s, "AXP", count, loop };
+  for (size_t i = 0; i < count; i++) {
+    std::this_thread::sleep_for(gap);
+    s->send(make_event("AXP", steady_ns(), trade{}));
+  }
+  algo.join_events();
+  auto latencies = std::move(algo.latencies);
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+// Sending count events round robin to algos on symbols S0 and up, which
+// make_algo creates for a session, a symbol and a number of events. Returns
+// the time until every event is handled and the sorted latencies of all
+// events.
+template<typename MakeAlgo>
+auto test_algo_layout(size_t algos, size_t count, MakeAlgo make_algo)
+{
+  auto s = std::make_shared<loopback_session>();
+  std::vector<std::string> symbols;
+  std::vector<decltype(make_algo(s, std::string{}, count))> running;
+  for (size_t i = 0; i < algos; i++) {
+    symbols.push_back("S" + std::to_string(i));
+    running.push_back(make_algo(s, symbols.back(), count / algos + 1));
+  }
+  auto start = clock_type::now();
+  for (size_t i = 0; i < count; i++) {
+    s->send(make_event(symbols[i % algos], steady_ns(), trade{}));
+  }
+  std::vector<uint64_t> latencies;
+  for (auto& algo : running) {
+    algo->stop();
+    latencies.insert(latencies.end(), algo->latencies.begin(), algo->latencies.end());
+  }
+  auto end = clock_type::now();
+  std::sort(latencies.begin(), latencies.end());
+  return std::make_pair(end - start, std::move(latencies));
+}
+
+int main(int argc, char* argv[])
+{
+  // Orders the book phases hold at once, the first argument if given. The
+  // arena is sized for all of them up front, about 120 bytes an order, so
+  // the default stays within a few hundred MB.
+  size_t count = 2000000;
+  if (argc > 1) {
+    count = std::stoull(argv[1]);
+    if (count == 0) {
+      std::cerr << "usage: " << argv[0] << " [orders]" << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "orders: " << count << ", arena: "
+            << order_book_arena::bytes_for(count, 4096) / (1024 * 1024) << " MB" << std::endl;
+
+  // Every allocation the arena takes from the global heap goes through
+  // heap_allocs; the steady state phases should not add any.
+  counting_resource heap_allocs{ std::pmr::new_delete_resource() };
+  order_book_arena arena{ count, 4096, &heap_allocs };
+  order_book ob{ "AXP", 0, count, arena.resource() };
+  size_t allocs[5];
+  allocs[0] = heap_allocs.allocations();
   auto add_duration = test_add(ob, count);
+  allocs[1] = heap_allocs.allocations();
   auto cancel_duration = test_cancel(ob, count);
+  allocs[2] = heap_allocs.allocations();
   auto remove_duration = test_remove(ob, count);
+  allocs[3] = heap_allocs.allocations();
   auto add_duration_rnd_price = test_add_rnd_price(ob, count);
+  allocs[4] = heap_allocs.allocations();
 
   std::cout << "order_book::add()     " << std::chrono::duration_cast<std::chrono::nanoseconds>(add_duration).count() / count << " ns/op" << std::endl;
   std::cout << "order_book::add_rnd() " << std::chrono::duration_cast<std::chrono::nanoseconds>(add_duration_rnd_price).count() / count << " ns/op" << std::endl;
   std::cout << "order_book::cancel()  " << std::chrono::duration_cast<std::chrono::nanoseconds>(cancel_duration).count() / count << " ns/op" << std::endl;
   std::cout << "order_book::remove()  " << std::chrono::duration_cast<std::chrono::nanoseconds>(remove_duration).count() / count << " ns/op" << std::endl;
+  size_t decode_count = 3000000;
+  auto payload = make_itch_payload(decode_count);
+  auto decode_duration = test_decode(payload, decode_count);
+  std::cout << "itch_bist_decode()    " << std::chrono::duration_cast<std::chrono::nanoseconds>(decode_duration).count() / decode_count << " ns/msg" << std::endl;
+  std::vector<nasdaq::itch_bist_decoded_message> msgs;
+  nasdaq::itch_bist_decode_payload(net::packet_view{ payload.data(), payload.size() }, msgs);
+  size_t callback_events = 0;
+  nasdaq::itch_bist_handler<> callback_handler;
+  callback_handler.register_event_callback([&callback_events](const event&) { callback_events++; });
+  auto callback_duration = test_handler(callback_handler, msgs);
+  nasdaq::itch_bist_handler<counting_listener> listener_handler;
+  auto listener_duration = test_handler(listener_handler, msgs);
+  if (callback_events != listener_handler.listener().events) {
+    std::cout << "oupss!\n";
+  }
+  std::cout << "handler (callback)    " << std::chrono::duration_cast<std::chrono::nanoseconds>(callback_duration).count() / decode_count << " ns/msg" << std::endl;
+  std::cout << "handler (listener)    " << std::chrono::duration_cast<std::chrono::nanoseconds>(listener_duration).count() / decode_count << " ns/msg" << std::endl;
+  size_t handoff_count = 1000000;
+  auto asio_duration = test_handoff_asio(handoff_count);
+  auto ring_duration = test_handoff_ring(handoff_count);
+  std::cout << "handoff (asio)        " << std::chrono::duration_cast<std::chrono::nanoseconds>(asio_duration).count() / handoff_count << " ns/msg" << std::endl;
+  std::cout << "handoff (ring)        " << std::chrono::duration_cast<std::chrono::nanoseconds>(ring_duration).count() / handoff_count << " ns/msg" << std::endl;
+  uint32_t instruments = 256;
+  auto market = make_itch_payload(decode_count, instruments);
+  nasdaq::itch_bist_handler<counting_listener> single_handler;
+  auto single_duration = test_feed(single_handler, instruments, market);
+  std::cout << "market (1 thread)     " << std::chrono::duration_cast<std::chrono::nanoseconds>(single_duration).count() / decode_count << " ns/msg" << std::endl;
+  for (size_t shards : { 1, 2, 4, 8 }) {
+    nasdaq::itch_bist_sharded_handler<counting_listener> sharded_handler{ shards };
+    auto sharded_duration = test_feed(sharded_handler, instruments, market);
+    size_t events = 0;
+    for (size_t i = 0; i < shards; i++) {
+      events += sharded_handler.listener(i).events;
+    }
+    if (events != single_handler.listener().events) {
+      std::cout << "oupss!\n";
+    }
+    std::cout << "market (" << shards << " shards)     " << std::chrono::duration_cast<std::chrono::nanoseconds>(sharded_duration).count() / decode_count << " ns/msg" << std::endl;
+  }
+  check_coalescing(instruments, make_itch_payload(300000, instruments));
+  check_sharding(instruments, 4, make_itch_payload(300000, instruments));
+  size_t wake_count = 5000;
+  std::pair<const char*, event_wait> waits[] = {
+    { "block  ", event_wait::block },
+    { "spin   ", event_wait::spin },
+    { "backoff", event_wait::backoff },
+    { "hybrid ", event_wait::hybrid },
+  };
+  for (auto [name, wait] : waits) {
+    auto latencies = test_wake_latency(event_loop_options{ wait }, wake_count, std::chrono::microseconds{ 100 });
+    uint64_t sum = 0;
+    for (auto latency : latencies) {
+      sum += latency;
+    }
+    std::cout << "wake (" << name << ")        " << sum / latencies.size() << " ns mean, "
+              << latencies[latencies.size() / 2] << " ns p50, "
+              << latencies[latencies.size() * 99 / 100] << " ns p99" << std::endl;
+  }
+  size_t layout_algos = 170;
+  size_t layout_count = 1000000;
+  auto print_layout = [&](const char* name, const auto& result) {
+    auto& [duration, latencies] = result;
+    std::cout << name << std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / layout_count << " ns/event, "
+              << latencies[latencies.size() / 2] << " ns p50, "
+              << latencies[latencies.size() * 99 / 100] << " ns p99" << std::endl;
+  };
+  print_layout("algos (thread each)   ", test_algo_layout(layout_algos, layout_count,
+    [](std::weak_ptr<session> s, std::string symbol, size_t count) {
+      return std::make_unique<latency_algo>(s, symbol, count);
+    }));
+  {
+    algo_scheduler scheduler{ std::max<size_t>(std::thread::hardware_concurrency(), 1) };
+    print_layout("algos (scheduler)     ", test_algo_layout(layout_algos, layout_count,
+      [&scheduler](std::weak_ptr<session> s, std::string symbol, size_t count) {
+        return std::make_unique<latency_algo>(s, symbol, count, scheduler);
+      }));
+    print_layout("algos (coroutine)     ", test_algo_layout(layout_algos, layout_count,
+      [&scheduler](std::weak_ptr<session> s, std::string symbol, size_t count) {
+        return std::make_unique<latency_coroutine>(s, symbol, count, scheduler);
+      }));
+    // every algo on a worker of its own, which goes with the algo
+    print_layout("algos (dedicated)     ", test_algo_layout(scheduler.worker_count(), layout_count,
+      [&scheduler, cpu = 0](std::weak_ptr<session> s, std::string symbol, size_t count) mutable {
+        return std::make_unique<latency_algo>(s, symbol, count, scheduler, thread_placement{ cpu++ });
+      }));
+    if (scheduler.dedicated_worker_count() != 0) {
+      std::cout << "oupss!\n";
+    }
+  }
+  std::cout << "heap allocations: add " << allocs[1] - allocs[0]
+            << ", cancel " << allocs[2] - allocs[1]
+            << ", remove " << allocs[3] - allocs[2]
+            << ", add_rnd " << allocs[4] - allocs[3] << std::endl;
 }